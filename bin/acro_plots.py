@@ -55,6 +55,9 @@ def plotData(axis, globs, groupnames, col, qimprovement=True, colors=None, marke
                     #Read from the file
                     line = fin.readline()
                     while line != '':
+                        if line.startswith('#'): # e.g. the footer of a finished run
+                            line = fin.readline()
+                            continue
                         splitLine = line.split()
                         score = float(splitLine[col])
                         data[-1][-1].append(score)
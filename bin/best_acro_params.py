@@ -4,6 +4,10 @@ import glob
 import collections
 import sys
 
+def rows(fin):
+    # Skips comment lines, such as the footer of a finished run
+    return (line for line in fin if not line.startswith("#"))
+
 def getFinalPerformance(fileGlob):
     files = glob.glob(fileGlob)
     if len(files) == 0:
@@ -14,7 +18,7 @@ def getFinalPerformance(fileGlob):
         count = 0
         for f in files:
             fin = open(f, "r")
-            q = collections.deque(fin, 101)
+            q = collections.deque(rows(fin), 101)
             if len(q) < 101:
                 print(f + " only has " + str(len(q)) + " lines!", file=sys.stderr)
             else:
@@ -54,9 +58,9 @@ def getBestParams(filePrefix, benchmark, qGlob, useTemp):
                     files.sort()
                     for i in range(len(files)):
                         fin = open(files[i], "r")
-                        lines = fin.readlines()
+                        lines = list(rows(fin))
                         qin = open(qFiles[i], "r")
-                        qlines = qin.readlines()
+                        qlines = list(rows(qin))
 
                         q = collections.deque(fin, 100)
                         qq = collections.deque(fin, 100)
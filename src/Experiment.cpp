@@ -0,0 +1,1255 @@
+#include "Experiment.hpp"
+#include "TileCodingQFunction.hpp"
+#include "IncDTModel.hpp"
+#include "MountainCar.hpp"
+#include "Acrobot.hpp"
+#include "GoRight.hpp"
+#include "dout.hpp"
+#include "Trace.hpp"
+#include "Hash.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <filesystem>
+#include <sstream>
+#include <torch/torch.h>
+
+using namespace std;
+
+// libtorch's seed is process-wide, so seeding and building the networks must
+// not interleave between experiments running on different threads.
+static mutex torchSeedMutex;
+
+// Column and .hist section names for each LatencyPhase
+static const string latencyNames[] = {"act", "plan", "learn", "split"};
+
+// The last line of a finished .result file, followed by the run's hash in hex
+static const string footerPrefix = "# complete ";
+
+Experiment::Experiment(const Config& config) :
+   config_(config),
+   initRNG_(config_.seed),
+   rng_(initRNG_.randomInt()),
+   planner_(Planner::get(config_.planner)),
+   game_(config_.game),
+   uncertainEnv_(nullptr),
+   modelUpdated_(false),
+   totalTime_(0),
+   totalPlanTime_(0),
+   totalFrames_(0),
+   framesSinceSplit_(0),
+   stats_(config_.horizon),
+   numFrames_(0),
+   epReward_(0),
+   epReturn_(0),
+   totalDiscount_(1),
+   epPlanTime_(0),
+   horizon_(config_.horizon),
+   padW_(15),
+   numColumns_(0),
+   binOut_(nullptr),
+   recorder_(nullptr),
+   replay_(nullptr),
+   evalColumn_(0),
+   lastCheckpoint_(0),
+   evalReturnTotal_(0),
+   numEvals_(0),
+   perf_(nullptr),
+   epLatency_(numLatencies),
+   runLatency_(numLatencies),
+   liveFrames_(0),
+   liveLeaves_(0),
+   liveEvalReturn_(0),
+   beatFrames_(0),
+   beatTime_(chrono::steady_clock::now()),
+   heartbeat_(nullptr) {
+   unique_lock<mutex> torchLock(torchSeedMutex);
+   torch::manual_seed(initRNG_.randomInt());
+
+   env_ = makeEnvironment(initRNG_);
+   if(game_ == "MC") {
+      stateDim_ = 2;
+      numActions_ = 3;
+      dimRanges_ = {{-1.2, 0.6}, {-0.07, 0.07}};
+      qFunc_ = new TileCodingQFunction(dimRanges_, // feature ranges
+				       {8, 8}, // numDivisions
+				       8, // num tilings
+				       numActions_,
+				       initRNG_);
+   } else if(game_ == "A") {
+      stateDim_ = 4;
+      numActions_ = 3;
+      dimRanges_ = {{-M_PI, M_PI}, {-M_PI, M_PI}, {-4*M_PI, 4*M_PI}, {-9*M_PI, 9*M_PI}};
+      vector<size_t> numDivisions({6, 7, 6, 7});
+
+      vector<QFunction*> qFuncs;
+      // all 4 dimensions
+      qFuncs.push_back(new TileCodingQFunction(dimRanges_, numDivisions, 12, numActions_, rng_));
+      // choose 3 dimensions / exclude 1 dimension
+      for (size_t i = 0; i < stateDim_; ++i) {
+         vector<size_t> curNumDivisions = numDivisions;
+         curNumDivisions[i] = 1;
+         qFuncs.push_back(new TileCodingQFunction(dimRanges_, curNumDivisions, 3, numActions_, rng_));
+      }
+      // choose 2 dimensions / exclude 2 dimension
+      for (size_t i = 0; i < stateDim_; ++i) {
+         for (size_t j = i+1; j < stateDim_; ++j) {
+            vector<size_t> curNumDivisions = numDivisions;
+            curNumDivisions[i] = 1;
+            curNumDivisions[j] = 1;
+            qFuncs.push_back(new TileCodingQFunction(dimRanges_, curNumDivisions, 2, numActions_, rng_));
+	 }
+      }
+      // choose 1 dimension
+      for (size_t i = 0; i < stateDim_; ++i) {
+         vector<size_t> curNumDivisions(stateDim_, 1);
+         curNumDivisions[i] = numDivisions[i];
+         qFuncs.push_back(new TileCodingQFunction(dimRanges_, curNumDivisions, 3, numActions_, rng_));
+      }
+      qFunc_ = new SumQ(qFuncs, numActions_);
+   } else if (game_ == "AD") {
+      stateDim_ = 5;
+      numActions_ = 3;
+      dimRanges_ = {{-M_PI, M_PI}, {-M_PI, M_PI}, {-4*M_PI, 4*M_PI}, {-9*M_PI, 9*M_PI}, {-9*M_PI, 9*M_PI}};
+      vector<size_t> numDivisions({6, 7, 6, 7, 7});
+
+      vector<QFunction*> qFuncs;
+      // all 5 dimensions
+      qFuncs.push_back(new TileCodingQFunction(dimRanges_, numDivisions, 20, numActions_, rng_));
+      // choose 4 dimensions / exclude 1 dimension
+      for (size_t i = 0; i < stateDim_; ++i) {
+         vector<size_t> curNumDivisions = numDivisions;
+         curNumDivisions[i] = 1;
+         qFuncs.push_back(new TileCodingQFunction(dimRanges_, curNumDivisions, 4, numActions_, rng_));
+      }
+      // choose 3 dimensions / exclude 2 dimension
+      for (size_t i = 0; i < stateDim_; ++i) {
+         for (size_t j = i+1; j < stateDim_; ++j) {
+            vector<size_t> curNumDivisions = numDivisions;
+            curNumDivisions[i] = 1;
+            curNumDivisions[j] = 1;
+            qFuncs.push_back(new TileCodingQFunction(dimRanges_, curNumDivisions, 2, numActions_, rng_));
+	 }
+      }
+      // choose 2 dimensions / exclude 3 dimension
+      for (size_t i = 0; i < stateDim_; ++i) {
+         for (size_t j = i+1; j < stateDim_; ++j) {
+            vector<size_t> curNumDivisions(stateDim_, 1);
+            curNumDivisions[i] = numDivisions[i];
+            curNumDivisions[j] = numDivisions[j];
+            qFuncs.push_back(new TileCodingQFunction(dimRanges_, curNumDivisions, 2, numActions_, rng_));
+	 }
+      }
+      // choose 1 dimension / exclude 4 dimension
+      for (size_t i = 0; i < stateDim_; ++i) {
+         vector<size_t> curNumDivisions(stateDim_, 1);
+         curNumDivisions[i] = numDivisions[i];
+         qFuncs.push_back(new TileCodingQFunction(dimRanges_, curNumDivisions, 4, numActions_, rng_));
+      }
+      qFunc_ = new SumQ(qFuncs, numActions_);
+   } else {// game == GR
+      size_t length = config_.gorLength;
+      size_t numInd = config_.gorNumInd;
+      uncertainEnv_ = new GoRightUncertain(initRNG_, config_);
+
+      if (planner_.name == "A") {
+	 stateDim_ = 3 + numInd;
+      } else {
+	 stateDim_ = 2 + numInd;
+      }
+      numActions_ = 2;
+
+      dimRanges_.push_back({rlfloat_t(-0.5), rlfloat_t(length + 0.5)});
+      for (size_t i = 0; i < numInd; ++i) {
+	 dimRanges_.push_back({rlfloat_t(-0.25), rlfloat_t(1.25)});
+      }
+      size_t maxStat = 2;
+      rlfloat_t statScale = length/maxStat;
+      dimRanges_.push_back({rlfloat_t(-0.5*statScale), rlfloat_t(statScale*(maxStat + 0.5))});
+
+      vector<size_t> numDiv;
+      numDiv.push_back(length + 1);
+      for (size_t i = 0; i < numInd; ++i) {
+	 numDiv.push_back(2);
+      }
+      numDiv.push_back(maxStat + 1);
+
+      qFunc_ = new TileCodingQFunction(dimRanges_,
+				       numDiv,
+				       1,
+				       numActions_,
+				       initRNG_);
+
+      // Tile coding ignores the last dim no matter what
+      // But the model might use it
+      if (stateDim_ == 3 + numInd) {
+	 dimRanges_.push_back({rlfloat_t(-0.5*statScale), rlfloat_t(statScale*(maxStat + 0.5))});
+      }
+   }
+
+   agent_ = new QLearner(qFunc_,
+			 numActions_,
+			 initRNG_,
+			 config_);
+
+   if (config_.useNN) {
+      model_ = new NNModel(stateDim_,    // inDim
+			   stateDim_,    // targetDim
+			   numActions_,
+			   dimRanges_,
+			   initRNG_,
+			   planner_.getTrainingType(config_),
+			   config_);
+   } else {
+      model_ = new IncDTModel(stateDim_,
+			      numActions_,
+			      initRNG_,
+			      config_);
+   }
+   torchLock.unlock();
+
+   if (planner_.oracle) {
+      planningModel_ = uncertainEnv_;
+   } else {
+      planningModel_ = dynamic_cast<BBIPredictionModel*>(model_);
+   }
+
+   if (!config_.replayExperience.empty()) {
+      replay_ = new ExperienceReader(config_.replayExperience);
+   }
+
+   // Everything above is rebuilt exactly as it was, then the checkpoint
+   // overwrites whatever has changed since
+   if (config_.resume and filesystem::exists(getCheckpointName())) {
+      loadCheckpoint();
+   } else {
+      out_.open(config_.output + ".result");
+      if (!out_.is_open()) {
+	 cerr << "Failed to open the output file: " << config_.output + ".result" << endl;
+	 exit(1);
+      }
+      if (config_.binaryOutput) {
+	 binOut_ = new ResultWriter(config_.output + ".result.bin");
+      }
+      if (!config_.recordExperience.empty()) {
+	 recorder_ = new ExperienceWriter(config_.recordExperience);
+      }
+      writeHeader();
+   }
+
+   if (config_.heartbeat > 0) {
+      liveFrames_ = totalFrames_;
+      liveLeaves_ = model_->getNumLeaves();
+      beatFrames_ = totalFrames_;
+      heartbeat_ = new Heartbeat(config_.output + ".heartbeat", config_.heartbeat, [this] {return getHeartbeatStatus();});
+   }
+}
+
+Experiment::~Experiment() {
+   delete heartbeat_;
+
+   // The evaluations in flight use this experiment's settings
+   for (auto& e : pendingEvals_) {
+      e.wait();
+   }
+
+   delete env_;
+   delete uncertainEnv_;
+   delete agent_;
+   for (auto traj : data_) {
+      delete traj;
+   }
+   delete model_;
+
+   out_.close();
+   delete binOut_;
+   delete recorder_;
+   delete replay_;
+   delete perf_;
+}
+
+void Experiment::writeHeader() {
+   addColumn("totFrames", intColumn);
+   addColumn("epFPS", floatColumn);
+   addColumn("totalFPS", floatColumn);
+   addColumn("epPlanFPS", floatColumn);
+   addColumn("totalPlanFPS", floatColumn);
+   addColumn("epScore", floatColumn);
+   addColumn("epReturn", floatColumn);
+   addColumn("epFrames", intColumn);
+   addColumn("evalScore", floatColumn);
+   addColumn("evalReturn", floatColumn);
+   addColumn("evalFrames", intColumn);
+   addColumn("effHoriz", floatColumn);
+
+   string errNames[] {"StateErr", "RwdErr", "TermErr", "PredErr", "TargErr", "UncErr", "NumInf", "Num-Inf", "uErrMin", "uErrLQ", "uErrMed", "uErrUQ", "uErrMax", "utCorr"};
+   for (auto name : errNames) {
+      ResultColumnType type = (name == "NumInf" or name == "Num-Inf") ? intColumn : floatColumn;
+      for (size_t h = 2; h <= horizon_; ++h) {
+	 addColumn(name + "_h" + to_string(h), type);
+      }
+      // The totals are all accumulated as floats
+      addColumn(name, floatColumn);
+   }
+   if (config_.perfCounters) {
+      for (auto& name : PerfCounters::getNames()) {
+	 addColumn(name, floatColumn);
+      }
+   }
+#ifdef ALLOC_STATS
+   for (auto& name : AllocStats::getNames()) {
+      addColumn(name, floatColumn);
+   }
+#endif
+   if (config_.footprint) {
+      for (auto& name : Footprint::getNames()) {
+	 addColumn(name, intColumn);
+      }
+   }
+   if (config_.latencyHist) {
+      for (auto phase : latencyNames) {
+	 for (auto stat : {"P50", "P90", "P99", "Max"}) {
+	    addColumn(phase + stat, floatColumn);
+	 }
+      }
+   }
+   if (config_.evalEpisodes > 0) {
+      addColumn("evalSD", floatColumn);
+      addColumn("evalRetSD", floatColumn);
+   }
+
+   out_ << endl;
+   if (binOut_) {
+      binOut_->writeHeader();
+   }
+}
+
+void Experiment::addColumn(const string& name, ResultColumnType type) {
+   ++numColumns_;
+   out_ << setw(padW_) << to_string(numColumns_) + "_" + name;
+   if (binOut_) {
+      binOut_->addColumn(name, type);
+   }
+}
+
+void Experiment::writeColumn(double value) {
+   row_.push_back({floatColumn, value, 0});
+}
+
+void Experiment::writeColumn(size_t value) {
+   row_.push_back({intColumn, 0, value});
+}
+
+void Experiment::endRow() {
+   for (auto& cell : row_) {
+      if (cell.type == intColumn) {
+	 out_ << setw(padW_) << cell.intValue;
+	 if (binOut_) {
+	    binOut_->append(uint64_t(cell.intValue));
+	 }
+      } else {
+	 out_ << setw(padW_) << cell.floatValue;
+	 if (binOut_) {
+	    binOut_->append(cell.floatValue);
+	 }
+      }
+   }
+   row_.clear();
+
+   out_ << endl;
+   if (binOut_) {
+      binOut_->endRow();
+   }
+}
+
+void Experiment::run() {
+   runUntil(config_.numFrames);
+   writeFooter();
+}
+
+void Experiment::runUntil(size_t frames) {
+   openCounters();
+   while (totalFrames_ < min(frames, config_.numFrames)) {
+      runIteration();
+
+      // The final checkpoint lets a resumed sweep skip finished runs
+      if (config_.checkpointEvery > 0 and
+	  (totalFrames_ - lastCheckpoint_ >= config_.checkpointEvery or totalFrames_ >= config_.numFrames)) {
+	 finishEvals();
+	 saveCheckpoint();
+      }
+   }
+   finishEvals();
+}
+
+double Experiment::getMeanEvalReturn() const {
+   return numEvals_ > 0 ? evalReturnTotal_/numEvals_ : 0;
+}
+
+void Experiment::writeFooter() {
+   if (config_.latencyHist) {
+      writeHistograms();
+   }
+   out_ << footerPrefix << hex << setw(16) << setfill('0') << config_.runHash << dec << setfill(' ') << endl;
+}
+
+bool Experiment::isComplete(const Config& config) {
+   if (config.binaryOutput and !filesystem::exists(config.output + ".result.bin")) {
+      return false;
+   }
+
+   ifstream resultIn(config.output + ".result", ios::binary | ios::ate);
+   if (!resultIn.is_open()) {
+      return false;
+   }
+   streamoff size = resultIn.tellg();
+   streamoff footerSize = footerPrefix.size() + 16 + 1;
+   if (size < footerSize) {
+      return false;
+   }
+   string footer(footerSize, ' ');
+   resultIn.seekg(size - footerSize);
+   resultIn.read(&footer[0], footerSize);
+   if (!resultIn or footer.compare(0, footerPrefix.size(), footerPrefix) != 0) {
+      return false;
+   }
+
+   ostringstream expected;
+   expected << footerPrefix << hex << setw(16) << setfill('0') << config.runHash << "\n";
+   return footer == expected.str();
+}
+
+string Experiment::getCheckpointName() const {
+   return config_.output + ".ckpt";
+}
+
+// Guards against resuming from some other run's checkpoint
+string Experiment::getCheckpointKey() const {
+   return config_.output + " " + config_.game + " " + config_.planner + " " + to_string(config_.seed) + " " +
+      to_string(config_.horizon) + " " + to_string(config_.useNN) + " " + to_string(config_.binaryOutput);
+}
+
+// Taken between iterations, so the per-episode and per-iteration values need not be saved
+void Experiment::saveCheckpoint() {
+   CheckpointWriter out(getCheckpointName());
+   out.write(getCheckpointKey());
+
+   out.write(initRNG_);
+   out.write(rng_);
+   out.write(modelUpdated_);
+   out.write(totalTime_);
+   out.write(totalPlanTime_);
+   out.write(totalFrames_);
+   out.write(framesSinceSplit_);
+   out.write(evalReturnTotal_);
+   out.write(numEvals_);
+   for (auto& h : runLatency_) {
+      h.save(out);
+   }
+
+   out.write(data_.size());
+   for (auto traj : data_) {
+      traj->save(out);
+      out.addTrajectory(traj);
+   }
+
+   agent_->save(out);
+   env_->save(out);
+   if (uncertainEnv_) {
+      uncertainEnv_->save(out);
+   }
+   model_->save(out);
+
+   // Rows written after this point are dropped on resume
+   out.write(uint64_t(out_.tellp()));
+   out.write(uint64_t(binOut_ ? binOut_->getSize() : 0));
+
+   out.commit();
+   lastCheckpoint_ = totalFrames_;
+}
+
+void Experiment::loadCheckpoint() {
+   CheckpointReader in(getCheckpointName());
+   string key;
+   in.read(key);
+   if (key != getCheckpointKey()) {
+      cerr << "Checkpoint " << getCheckpointName() << " was written by a different run: " << key << endl;
+      exit(1);
+   }
+
+   in.read(initRNG_);
+   in.read(rng_);
+   in.read(modelUpdated_);
+   in.read(totalTime_);
+   in.read(totalPlanTime_);
+   in.read(totalFrames_);
+   in.read(framesSinceSplit_);
+   in.read(evalReturnTotal_);
+   in.read(numEvals_);
+   for (auto& h : runLatency_) {
+      h.load(in);
+   }
+
+   size_t numTrajs;
+   in.read(numTrajs);
+   for (size_t i = 0; i < numTrajs; ++i) {
+      Trajectory* traj = new Trajectory(State());
+      traj->load(in);
+      data_.push_back(traj);
+      in.addTrajectory(traj);
+   }
+
+   agent_->load(in);
+   env_->load(in);
+   if (uncertainEnv_) {
+      uncertainEnv_->load(in);
+   }
+   model_->load(in);
+
+   uint64_t resultSize;
+   uint64_t binResultSize;
+   in.read(resultSize);
+   in.read(binResultSize);
+
+   string resultName = config_.output + ".result";
+   error_code err;
+   if (filesystem::file_size(resultName, err) < resultSize or err) {
+      cerr << "The output file is shorter than its checkpoint: " << resultName << endl;
+      exit(1);
+   }
+   filesystem::resize_file(resultName, resultSize);
+   out_.open(resultName, ios::app | ios::ate);
+   if (!out_.is_open()) {
+      cerr << "Failed to open the output file: " << resultName << endl;
+      exit(1);
+   }
+   if (config_.binaryOutput) {
+      binOut_ = new ResultWriter(config_.output + ".result.bin", binResultSize);
+   }
+   // Each learning episode so far left one trajectory
+   if (!config_.recordExperience.empty()) {
+      recorder_ = new ExperienceWriter(config_.recordExperience, data_.size());
+   }
+
+   lastCheckpoint_ = totalFrames_;
+}
+
+PredictionModel* Experiment::makeEnvironment(RNG& rng) const {
+   if (game_ == "MC") {
+      return new MountainCar();
+   } else if (game_ == "A") {
+      return new Acrobot(false, rng);
+   } else if (game_ == "AD") {
+      return new Acrobot(true, rng);
+   } else {
+      return new GoRight(config_);
+   }
+}
+
+State Experiment::getInitialState() {
+   return getInitialState(rng_);
+}
+
+State Experiment::getInitialState(RNG& rng) const {
+   State curState;
+   if (game_ == "MC") {
+      curState = {0,0};
+   } else if (game_ == "A") {
+      curState = {0,0,0,0};
+   } else if (game_ == "AD") {
+      curState = {0,0,0,0,0};
+   } else if (game_ == "GR") {
+      curState.push_back(rng.randomFloat()*0.5 - 0.25);
+
+      size_t length = config_.gorLength;
+      size_t numInd = config_.gorNumInd;
+      for (size_t i = 0; i < numInd; ++i) {
+	 curState.push_back(0);
+      }
+
+      size_t numStat = 3;
+      rlfloat_t statScale = double(length)/(numStat - 1);
+      rlfloat_t prevStat = int(rng.randomFloat()*numStat)*statScale;
+      rlfloat_t initStat = int(rng.randomFloat()*numStat)*statScale;
+      rlfloat_t statOffset = rng.randomFloat()*statScale/2 - statScale/4;
+      curState.push_back(statOffset + initStat);
+      curState.push_back(statOffset + prevStat);
+   }
+   return curState;
+}
+
+Experiment::IterationStats::IterationStats(size_t horizon) :
+   uncSum(horizon-1, 0),
+   tgtSum(horizon-1, 0),
+   uncXtgt(horizon-1, 0),
+   uncXunc(horizon-1, 0),
+   tgtXtgt(horizon-1, 0),
+   nonInf(horizon-1, 0),
+   stateError(horizon-1, 0),
+   rwdError(horizon-1, 0),
+   termError(horizon-1, 0),
+   predError(horizon-1, 0),
+   targetError(horizon-1, 0),
+   uncertaintyErrors(horizon-1),
+   uncertaintyError(horizon-1, 0),
+   numInf(horizon-1, 0),
+   numNegInf(horizon-1, 0),
+   learnFrames(0),
+   measuredFrames(0),
+   effectiveHorizon(0) {
+}
+
+void Experiment::runIteration() {
+   stats_ = IterationStats(horizon_);
+
+   if (config_.evalEpisodes == 0) {
+      for (unsigned char eval = 0; eval < 2; ++eval) {
+	 runEpisode(eval);
+      }
+      endRow();
+      return;
+   }
+
+   runEpisode(false);
+
+   // The evaluation columns are filled in once the evaluation episodes are done
+   size_t evalColumn = row_.size();
+   writeColumn(0.0);
+   writeColumn(0.0);
+   writeColumn(size_t(0));
+   writeStats();
+   writeColumn(0.0);
+   writeColumn(0.0);
+   vector<ResultCell> row;
+   row.swap(row_);
+
+   // The previous row's evaluation ran alongside this learning episode
+   finishEvals();
+   startEvals(row, evalColumn);
+}
+
+void Experiment::startEvals(vector<ResultCell>& row, size_t evalColumn) {
+   pendingRow_.swap(row);
+   evalColumn_ = evalColumn;
+
+   shared_ptr<const QFunction> snapshot(qFunc_->clone());
+   for (size_t e = 0; e < config_.evalEpisodes; ++e) {
+      unsigned seed = rng_.randomInt();
+      pendingEvals_.push_back(async(launch::async, [this, snapshot, seed]() {
+	 return runEvalEpisode(*snapshot, seed);
+      }));
+   }
+}
+
+void Experiment::finishEvals() {
+   if (pendingEvals_.empty()) {
+      return;
+   }
+
+   vector<EvalResult> results;
+   for (auto& e : pendingEvals_) {
+      results.push_back(e.get());
+   }
+   pendingEvals_.clear();
+
+   double meanScore = 0;
+   double meanReturn = 0;
+   double meanFrames = 0;
+   for (auto& r : results) {
+      meanScore += r.score/results.size();
+      meanReturn += r.discountedReturn/results.size();
+      meanFrames += double(r.numFrames)/results.size();
+   }
+   double scoreVar = 0;
+   double returnVar = 0;
+   if (results.size() > 1) {
+      for (auto& r : results) {
+	 scoreVar += (r.score - meanScore)*(r.score - meanScore)/(results.size() - 1);
+	 returnVar += (r.discountedReturn - meanReturn)*(r.discountedReturn - meanReturn)/(results.size() - 1);
+      }
+   }
+
+   evalReturnTotal_ += meanReturn;
+   ++numEvals_;
+   liveEvalReturn_.store(meanReturn, memory_order_relaxed);
+
+   pendingRow_[evalColumn_] = {floatColumn, meanScore, 0};
+   pendingRow_[evalColumn_ + 1] = {floatColumn, meanReturn, 0};
+   pendingRow_[evalColumn_ + 2] = {intColumn, 0, size_t(round(meanFrames))};
+   pendingRow_[pendingRow_.size() - 2] = {floatColumn, sqrt(scoreVar), 0};
+   pendingRow_[pendingRow_.size() - 1] = {floatColumn, sqrt(returnVar), 0};
+
+   row_.swap(pendingRow_);
+   pendingRow_.clear();
+   endRow();
+}
+
+// Touches nothing that learning changes, so it can run on any thread
+Experiment::EvalResult Experiment::runEvalEpisode(const QFunction& qFunc, unsigned seed) const {
+   ALLOC_PHASE(AllocStats::eval);
+   RNG rng(seed);
+   PredictionModel* env = makeEnvironment(rng);
+
+   EvalResult result = {0, 0, 0};
+   rlfloat_t discount = 1;
+   State curState = getInitialState(rng);
+   bool terminated = false;
+   for (size_t t = 0; t < 500 and !terminated; ++t) {
+      act_t action = get<0>(QLearner::greedy(qFunc, numActions_, rng, curState));
+
+      State resultState;
+      {
+	 TRACE_SCOPE("envStep");
+	 env->getStatePrediction(curState, action, resultState);
+      }
+      rlfloat_t r = env->getRewardPrediction(curState, action);
+      terminated = env->getTermPrediction(curState, action) > 0.5;
+
+      result.score += r;
+      result.discountedReturn += discount*r;
+      discount *= config_.discount;
+      ++result.numFrames;
+      curState = resultState;
+   }
+
+   delete env;
+   return result;
+}
+
+void Experiment::runEpisode(bool eval) {
+   ALLOC_PHASE(eval ? AllocStats::eval : AllocStats::act);
+   beginEpisode();
+
+   State curState = getInitialState();
+
+   bool terminated = false;
+
+   if (!eval) {
+      data_.push_back(new Trajectory(curState, terminated));
+      if (replay_) {
+	 checkReplayStart(curState);
+      }
+   }
+
+   auto epStart = chrono::high_resolution_clock::now();
+
+   for (size_t t = 0; t < 500 and !terminated; ++t) {
+      auto actStart = chrono::high_resolution_clock::now();
+      act_t action = chooseAction(curState, eval);
+
+      State resultState;
+
+      if (eval) {
+	 DOUT << "Eval ";
+      }
+      DOUT << "Frame: " << totalFrames_ << " Episode Step " << t << ": ";
+      for (auto d : curState) {
+	 DOUT << d << " ";
+      }
+      DOUT << " action: " << action << endl;
+
+      rlfloat_t r;
+      if (replay_ and !eval) {
+	 replayStep(t, action, resultState, r, terminated);
+      } else {
+	 {
+	    TRACE_SCOPE("envStep");
+	    env_->getStatePrediction(curState, action, resultState);
+	 }
+	 r = env_->getRewardPrediction(curState, action);
+	 terminated = env_->getTermPrediction(curState, action) > 0.5;
+      }
+      recordReward(r, eval);
+
+      if (!eval) {
+	 Trajectory& curTraj = *data_.back();
+	 curTraj.addStep(action, r, resultState, terminated);
+
+	 measurements_.clear();
+
+	 auto planStart = chrono::high_resolution_clock::now();
+	 recordLatency(actLatency, planStart - actStart);
+	 startCounters();
+
+	 planningUpdate(curTraj, t, measurements_);
+	 auto learnStart = chrono::high_resolution_clock::now();
+	 if (trainsModel()) {
+	    ALLOC_PHASE(AllocStats::modelLearn);
+	    model_->addExample(curTraj, t);
+	 }
+
+	 stopCounters();
+	 auto planEnd = chrono::high_resolution_clock::now();
+	 recordPlanTime(chrono::duration_cast<chrono::duration<double>>(planEnd - planStart).count());
+	 recordLatency(planLatency, learnStart - planStart);
+	 if (trainsModel()) {
+	    recordLatency(learnLatency, planEnd - learnStart);
+	 }
+
+	 recordMeasurements(measurements_);
+
+	 ++totalFrames_;
+	 ++framesSinceSplit_;
+	 liveFrames_.store(totalFrames_, memory_order_relaxed);
+
+	 if (updatesModel() and
+	     framesSinceSplit_ >= config_.updateEvery) {
+	    ALLOC_PHASE(AllocStats::modelSplit);
+	    DOUT << "Updating Model " << totalFrames_ << endl;
+	    auto splitStart = chrono::high_resolution_clock::now();
+	    startCounters();
+	    model_->updatePredictions();
+	    stopCounters();
+	    recordLatency(splitLatency, chrono::high_resolution_clock::now() - splitStart);
+	    liveLeaves_.store(model_->getNumLeaves(), memory_order_relaxed);
+	    framesSinceSplit_ = 0;
+	    modelUpdated_ = true;
+	 }
+      }
+      curState = resultState;
+   }
+
+   auto epEnd = chrono::high_resolution_clock::now();
+   auto epTime = chrono::duration_cast<chrono::duration<double>>(epEnd - epStart).count();
+   totalTime_ += epTime;
+
+   if (!eval and recorder_) {
+      recorder_->write(*data_.back());
+   }
+
+   writeEpisode(eval, epTime);
+}
+
+act_t Experiment::chooseAction(const State& state, bool eval) {
+   if (!eval) {
+      if (rng_.randomFloat() < config_.explorationRate) {
+	 return rng_.randomFloat()*numActions_;
+      } else {
+	 DOUT << "greedy (learned Q-function)" << endl;
+	 return agent_->getGreedyAction(state);
+      }
+   } else {
+      return agent_->getGreedyAction(state);
+   }
+}
+
+void Experiment::checkReplayStart(const State& state) const {
+   // The learning episodes so far each used one recorded trajectory
+   size_t episode = data_.size() - 1;
+   if (episode >= replay_->getNumTrajectories()) {
+      cerr << config_.replayExperience << " only holds " << replay_->getNumTrajectories()
+	   << " episodes, too few for " << config_.output << endl;
+      exit(1);
+   }
+   State start;
+   replay_->getStartState(episode, start);
+   if (start != state) {
+      cerr << "Episode " << episode << " of " << config_.output << " does not start where "
+	   << config_.replayExperience << " does; was it recorded with another game or seed?" << endl;
+      exit(1);
+   }
+}
+
+void Experiment::replayStep(size_t t, act_t action, State& resultState, rlfloat_t& reward, bool& terminated) const {
+   size_t episode = data_.size() - 1;
+   if (t >= replay_->getNumSteps(episode) or replay_->getAction(episode, t) != action) {
+      cerr << "Step " << t << " of episode " << episode << " of " << config_.output << " takes an action "
+	   << config_.replayExperience << " did not record; replays need the recording's seed and an exploration rate of 1" << endl;
+      exit(1);
+   }
+   replay_->getResultState(episode, t, resultState);
+   reward = replay_->getReward(episode, t);
+   terminated = replay_->getTerminated(episode, t);
+}
+
+void Experiment::beginEpisode() {
+   numFrames_ = 0;
+   epReward_ = 0;
+   epReturn_ = 0;
+   totalDiscount_ = 1;
+   epPlanTime_ = 0;
+}
+
+void Experiment::recordReward(rlfloat_t r, bool eval) {
+   epReward_ += r;
+   epReturn_ += totalDiscount_*r;
+   totalDiscount_ *= config_.discount;
+   ++numFrames_;
+   if (!eval) {
+      ++stats_.learnFrames;
+   }
+}
+
+void Experiment::planningUpdate(const Trajectory& traj, size_t t, QLearner::Measurements& measurements) {
+   TRACE_SCOPE("planningUpdate");
+   ALLOC_PHASE(AllocStats::plan);
+   measurements.measureErrors = measuresFrame();
+   if (planner_.plansWithModel and
+       ((planningModel_ != uncertainEnv_ and !modelUpdated_) or horizon_ == 1)) {
+      agent_->qUpdate(traj, t);
+   } else {
+      planner_.update(*agent_, traj, t, planningModel_, env_, uncertainEnv_, measurements);
+   }
+}
+
+bool Experiment::measuresFrame() const {
+   if (config_.measureEvery == 0 or totalFrames_ % config_.measureEvery != 0) {
+      return false;
+   }
+   if (config_.measureFraction >= 1) {
+      return true;
+   }
+
+   // Hashed rather than spaced evenly, so the frames picked do not line up
+   // with the episodes
+   uint64_t hash = fnv1a(&totalFrames_, sizeof(totalFrames_), fnv1a(&config_.seed, sizeof(config_.seed)));
+   return hash/18446744073709551616.0 < config_.measureFraction;
+}
+
+bool Experiment::trainsModel() const {
+   return planner_.learnsModel;
+}
+
+bool Experiment::updatesModel() const {
+   return planner_.plansWithModel and
+      planningModel_ != uncertainEnv_ and
+      horizon_ > 1;
+}
+
+void Experiment::recordPlanTime(double planTime) {
+   epPlanTime_ += planTime;
+   totalPlanTime_ += planTime;
+}
+
+void Experiment::recordLatency(LatencyPhase phase, chrono::high_resolution_clock::duration time) {
+   if (config_.latencyHist) {
+      epLatency_[phase].record(chrono::duration_cast<chrono::nanoseconds>(time).count());
+   }
+}
+
+void Experiment::writeHistograms() {
+   ofstream out(config_.output + ".hist");
+   if (!out.is_open()) {
+      cerr << "Failed to open the histogram file: " << config_.output + ".hist" << endl;
+      exit(1);
+   }
+   for (size_t p = 0; p < numLatencies; ++p) {
+      out << "# " << latencyNames[p] << " " << runLatency_[p].getCount() << " timings: lowerNs upperNs count" << endl;
+      runLatency_[p].write(out);
+   }
+}
+
+string Experiment::getHeartbeatStatus() {
+   size_t frames = liveFrames_.load(memory_order_relaxed);
+   auto now = chrono::steady_clock::now();
+   double seconds = chrono::duration_cast<chrono::duration<double>>(now - beatTime_).count();
+   double fps = seconds > 0 ? (frames - beatFrames_)/seconds : 0;
+   beatFrames_ = frames;
+   beatTime_ = now;
+
+   ostringstream status;
+   status << "output = " << config_.output << "\n"
+	  << "frames = " << frames << "\n"
+	  << "num_frames = " << config_.numFrames << "\n"
+	  << "fps = " << fps << "\n";
+   // Unknown until some progress has been seen
+   if (fps > 0) {
+      status << "eta_seconds = " << (config_.numFrames - min(frames, config_.numFrames))/fps << "\n";
+   }
+   status << "resident_bytes = " << getResidentBytes() << "\n"
+	  << "leaves = " << liveLeaves_.load(memory_order_relaxed) << "\n"
+	  << "last_eval_return = " << liveEvalReturn_.load(memory_order_relaxed) << "\n"
+	  << "finished = " << (frames >= config_.numFrames) << "\n"
+	  << "time = " << chrono::duration_cast<chrono::seconds>(chrono::system_clock::now().time_since_epoch()).count() << "\n";
+   return status.str();
+}
+
+void Experiment::startCounters() {
+   if (perf_) {
+      perf_->start();
+   }
+}
+
+void Experiment::stopCounters() {
+   if (perf_) {
+      perf_->stop();
+   }
+}
+
+void Experiment::openCounters() {
+#ifdef ALLOC_STATS
+   allocCounts_ = AllocStats::getCounts();
+#endif
+   if (!config_.perfCounters) {
+      return;
+   }
+   delete perf_;
+   perf_ = new PerfCounters();
+   perfCounts_.assign(PerfCounters::numCounters, 0);
+
+   static atomic<bool> warned(false);
+   if (!perf_->isAvailable() and !warned.exchange(true)) {
+      cerr << "Hardware performance counters are unavailable (see /proc/sys/kernel/perf_event_paranoid); their columns will be zero." << endl;
+   }
+}
+
+void Experiment::recordMeasurements(const QLearner::Measurements& measurements) {
+   ALLOC_PHASE(AllocStats::measure);
+   double totalWeight;
+   if (measurements.weights.size() > 0) {
+      totalWeight = measurements.weights[0];
+   } else {
+      totalWeight = 1;
+   }
+   double weightedHorizon = totalWeight;
+   // Frames left unmeasured still count toward the effective horizon
+   size_t horizon = measurements.weights.size();
+   if (measurements.measureErrors) {
+      horizon = measurements.stateError.size();
+      ++stats_.measuredFrames;
+   }
+   for (size_t h = 1; h < horizon; ++h) {
+      totalWeight += measurements.weights[h];
+      weightedHorizon += measurements.weights[h]*(h+1);
+
+      if (!measurements.measureErrors) {
+	 continue;
+      }
+
+      if (measurements.uncertainties[h] != numeric_limits<double>::infinity()) {
+	 stats_.uncSum[h-1] += measurements.uncertainties[h];
+	 stats_.tgtSum[h-1] += fabs(measurements.targetError[h]);
+	 stats_.uncXtgt[h-1] += measurements.uncertainties[h]*fabs(measurements.targetError[h]);
+	 stats_.uncXunc[h-1] += measurements.uncertainties[h]*measurements.uncertainties[h];
+	 stats_.tgtXtgt[h-1] += measurements.targetError[h]*fabs(measurements.targetError[h]);
+	 ++stats_.nonInf[h-1];
+      }
+
+      for (auto d : measurements.stateError[h]) {
+	 stats_.stateError[h-1] += (d*d)/stateDim_;
+	 stats_.predError[h-1] += (d*d)/(stateDim_+2);
+      }
+      rlfloat_t sqRErr = measurements.rwdError[h]*measurements.rwdError[h];
+      stats_.rwdError[h-1] += sqRErr;
+      stats_.predError[h-1] += sqRErr/(stateDim_+2);
+      rlfloat_t sqTErr = measurements.termError[h]*measurements.termError[h];
+      stats_.termError[h-1] += sqTErr;
+      stats_.predError[h-1] += sqTErr/(stateDim_+2);
+      stats_.targetError[h-1] += fabs(measurements.targetError[h]);
+      if (uncertainEnv_) { // If we have an oracle
+	 stats_.uncertaintyErrors[h-1].push_back(measurements.uncertaintyError[h]);
+	 if (measurements.uncertaintyError[h] == numeric_limits<double>::infinity()) {
+	    ++stats_.numInf[h-1];
+	 } else if (measurements.uncertaintyError[h] == -numeric_limits<double>::infinity()) {
+	    ++stats_.numNegInf[h-1];
+	 } else {
+	    stats_.uncertaintyError[h-1] += fabs(measurements.uncertaintyError[h]);
+	 }
+      } else {
+	 DOUT << "Pushing back 0" << endl;
+	 stats_.uncertaintyErrors[h-1].push_back(0);
+      }
+   }
+
+   stats_.effectiveHorizon += weightedHorizon/totalWeight;
+   DOUT << "Effective horizon: " << weightedHorizon/totalWeight << endl;
+}
+
+void Experiment::writeEpisode(bool eval, double epTime) {
+   if (!eval) {
+      writeColumn(totalFrames_);
+      writeColumn(double(numFrames_)/epTime);
+      writeColumn(double(totalFrames_)/totalTime_);
+      writeColumn(double(numFrames_)/epPlanTime_);
+      writeColumn(double(totalFrames_)/totalPlanTime_);
+   }
+   writeColumn(epReward_);
+   writeColumn(epReturn_);
+   writeColumn(numFrames_);
+
+   if (eval) {
+      evalReturnTotal_ += epReturn_;
+      ++numEvals_;
+      liveEvalReturn_.store(epReturn_, memory_order_relaxed);
+      writeStats();
+   }
+}
+
+void Experiment::writeStats() {
+   size_t horizon = horizon_;
+
+   vector<vector<rlfloat_t>*> errs({&stats_.stateError, &stats_.rwdError, &stats_.termError, &stats_.predError});
+   vector<vector<size_t>*> infCounts({&stats_.numInf, &stats_.numNegInf});
+
+   writeColumn(stats_.effectiveHorizon/stats_.learnFrames);
+
+   // The errors are averaged over the frames that had them measured
+   rlfloat_t total = 0;
+
+   for (size_t e = 0; e < errs.size(); ++e) { // stateErr, rwdErr, termErr
+      total = 0;
+      for (size_t h = 0; h < horizon-1; ++h) {
+	 writeColumn(sqrt((*errs[e])[h]/stats_.measuredFrames));
+	 total += (*errs[e])[h]/stats_.measuredFrames;
+      }
+      if (horizon > 1) {
+	 writeColumn(sqrt(total/(horizon-1)));
+      } else {
+	 writeColumn(0.0);
+      }
+   }
+
+   total = 0;
+   for (size_t h = 0; h < horizon-1; ++h) {
+      writeColumn(stats_.targetError[h]/stats_.measuredFrames);
+      total += stats_.targetError[h]/stats_.measuredFrames;
+   }
+   if (horizon > 1) {
+      writeColumn(sqrt(total/(horizon-1)));
+   } else {
+      writeColumn(0.0);
+   }
+
+   total = 0;
+   for (size_t h = 0; h < horizon-1; ++h) {
+      writeColumn(stats_.uncertaintyError[h]/(stats_.measuredFrames - stats_.numInf[h] - stats_.numNegInf[h]));
+      total += stats_.uncertaintyError[h]/(stats_.measuredFrames - stats_.numInf[h] - stats_.numNegInf[h]);
+   }
+   if (horizon > 1) {
+      writeColumn(sqrt(total/(horizon-1)));
+   } else {
+      writeColumn(0.0);
+   }
+
+   for (size_t c = 0; c < infCounts.size(); ++c) {
+      total = 0;
+      for (size_t h = 0; h < horizon-1; ++h) {
+	 writeColumn((*infCounts[c])[h]);
+	 total += (*infCounts[c])[h];
+      }
+      writeColumn(total);
+   }
+
+   vector<rlfloat_t> quantiles({0, 0.25, 0.5, 0.75, 1});
+   for (auto q : quantiles) {
+      vector<rlfloat_t> allErrs;
+      for (size_t h = 0; h < horizon-1; ++h) {
+	 if (stats_.uncertaintyErrors[h].size() > 0) {
+	    sort(stats_.uncertaintyErrors[h].begin(), stats_.uncertaintyErrors[h].end());
+	    size_t idx = (stats_.uncertaintyErrors[h].size()-1)*q;
+	    writeColumn(stats_.uncertaintyErrors[h][idx]);
+	    allErrs.insert(allErrs.end(), stats_.uncertaintyErrors[h].begin(), stats_.uncertaintyErrors[h].end());
+	 } else {
+	    writeColumn(0.0);
+	 }
+      }
+
+      if (allErrs.size() > 0) {
+	 sort(allErrs.begin(), allErrs.end());
+	 size_t idx = (allErrs.size()-1)*q;
+	 writeColumn(allErrs[idx]);
+      } else {
+	 writeColumn(0.0);
+      }
+   }
+
+   rlfloat_t totalUncSum = 0;
+   rlfloat_t totalTgtSum = 0;
+   rlfloat_t totalUncXTgt = 0;
+   rlfloat_t totalUncXUnc = 0;
+   rlfloat_t totalTgtXTgt = 0;
+   size_t totalNonInf = 0;
+   for (size_t h = 0; h < horizon-1; ++h) {
+      rlfloat_t corrNum = stats_.nonInf[h]*stats_.uncXtgt[h] - stats_.uncSum[h]*stats_.tgtSum[h];
+      rlfloat_t corrDenUnc = stats_.nonInf[h]*stats_.uncXunc[h] - stats_.uncSum[h]*stats_.uncSum[h];
+      if (corrDenUnc < 0) { // Can only happen because of floating point error
+	 corrDenUnc = 0;
+      }
+      rlfloat_t corrDenTgt = stats_.nonInf[h]*stats_.tgtXtgt[h] - stats_.tgtSum[h]*stats_.tgtSum[h];
+      if (corrDenTgt < 0) { // Can only happen because of floating point error
+	 corrDenTgt = 0;
+      }
+      rlfloat_t corrDen = sqrt(corrDenUnc) * sqrt(corrDenTgt);
+      DOUT << "stats_.nonInf[h] " << stats_.nonInf[h] << " stats_.uncXunc[h] " << stats_.uncXunc[h] << " stats_.uncSum[h] " << stats_.uncSum[h] << " stats_.tgtXtgt[h] " << stats_.tgtXtgt[h] << " stats_.tgtSum[h] " << stats_.tgtSum[h] << endl;
+      DOUT << "sqrt1: " << stats_.nonInf[h]*stats_.uncXunc[h] - stats_.uncSum[h]*stats_.uncSum[h] << " sqrt2: " << stats_.nonInf[h]*stats_.tgtXtgt[h] - stats_.tgtSum[h]*stats_.tgtSum[h] << endl;
+      DOUT << "corrNum: " << corrNum << " corrDen: " << corrDen << " corr: " << corrNum/corrDen << endl;
+
+      if (corrDen != 0) {
+	 writeColumn(corrNum/corrDen);
+      } else {
+	 writeColumn(0.0);
+      }
+
+      totalUncSum += stats_.uncSum[h];
+      totalTgtSum += stats_.tgtSum[h];
+      totalUncXTgt += stats_.uncXtgt[h];
+      totalUncXUnc += stats_.uncXunc[h];
+      totalTgtXTgt += stats_.tgtXtgt[h];
+      totalNonInf += stats_.nonInf[h];
+   }
+   rlfloat_t corrNum = totalNonInf*totalUncXTgt - totalUncSum*totalTgtSum;
+   rlfloat_t corrDenUnc = totalNonInf*totalUncXUnc - totalUncSum*totalUncSum;
+   if (corrDenUnc < 0) { // Can only happen because of floating point error
+      corrDenUnc = 0;
+   }
+   rlfloat_t corrDenTgt = totalNonInf*totalTgtXTgt - totalTgtSum*totalTgtSum;
+   if (corrDenTgt < 0) { // Can only happen because of floating point error
+      corrDenTgt = 0;
+   }
+   rlfloat_t corrDen = sqrt(corrDenUnc) * sqrt(corrDenTgt);
+
+   DOUT << "stats_.nonInf " << totalNonInf << " stats_.uncXunc " << totalUncXUnc << " stats_.uncSum " << totalUncSum << " stats_.tgtXtgt " << totalTgtXTgt << " stats_.tgtSum " << totalTgtSum << endl;
+   DOUT << "sqrt1: " << totalNonInf*totalUncXUnc - totalUncSum*totalUncSum << " sqrt2: " << totalNonInf*totalTgtXTgt - totalTgtSum*totalTgtSum << endl;
+   DOUT << "corrNum: " << corrNum << " corrDen: " << corrDen << " corr: " << corrNum/corrDen << endl;
+
+   if (corrDen != 0) {
+      writeColumn(corrNum/corrDen);
+   } else {
+      writeColumn(0.0);
+   }
+
+   if (perf_) {
+      vector<double> counts = perf_->read();
+      for (size_t c = 0; c < counts.size(); ++c) {
+	 writeColumn((counts[c] - perfCounts_[c])/stats_.learnFrames);
+      }
+      perfCounts_ = counts;
+   }
+
+#ifdef ALLOC_STATS
+   vector<double> allocCounts = AllocStats::getCounts();
+   for (size_t c = 0; c < allocCounts.size(); ++c) {
+      writeColumn((allocCounts[c] - allocCounts_[c])/stats_.learnFrames);
+   }
+   allocCounts_ = allocCounts;
+#endif
+
+   if (config_.footprint) {
+      Footprint footprint;
+      qFunc_->addFootprint(footprint);
+      model_->addFootprint(footprint);
+      for (auto traj : data_) {
+	 traj->addFootprint(footprint);
+      }
+      for (size_t p = 0; p < Footprint::numParts; ++p) {
+	 writeColumn(footprint.nodes[p]);
+	 writeColumn(footprint.bytes[p]);
+      }
+   }
+
+   if (config_.latencyHist) {
+      // In microseconds
+      for (size_t p = 0; p < numLatencies; ++p) {
+	 for (auto q : {0.5, 0.9, 0.99}) {
+	    writeColumn(epLatency_[p].getPercentile(q)/1000.0);
+	 }
+	 writeColumn(epLatency_[p].getMax()/1000.0);
+	 runLatency_[p].add(epLatency_[p]);
+	 epLatency_[p].clear();
+      }
+   }
+}
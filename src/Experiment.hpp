@@ -0,0 +1,230 @@
+#ifndef EXPERIMENT_HPP
+#define EXPERIMENT_HPP
+
+#include "QLearner.hpp"
+#include "Planner.hpp"
+#include "QFunction.hpp"
+#include "Trajectory.hpp"
+#include "PredictionModel.hpp"
+#include "NNModel.hpp"
+#include "RLTypes.hpp"
+#include "Config.hpp"
+#include "RNG.hpp"
+#include "ResultFile.hpp"
+#include "ExperienceFile.hpp"
+#include "Checkpoint.hpp"
+#include "PerfCounters.hpp"
+#include "AllocStats.hpp"
+#include "LatencyHistogram.hpp"
+#include "Heartbeat.hpp"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <future>
+#include <chrono>
+#include <atomic>
+
+// A single (config, seed) run: owns the environment, agent, model, and the
+// .result file, so several can live side by side in one process.
+class Experiment {
+  public:
+   Experiment(const Config& config);
+   virtual ~Experiment();
+
+   Experiment(const Experiment&) = delete;
+   Experiment& operator=(const Experiment&) = delete;
+
+   // Runs learning/evaluation episode pairs until num_frames is reached,
+   // checkpointing every checkpoint_every frames if asked to
+   virtual void run();
+   // Runs iterations until at least frames frames (at most num_frames) have
+   // been seen, so a sweep can stop and later continue the same run
+   virtual void runUntil(std::size_t frames);
+
+   std::size_t getTotalFrames() const {return totalFrames_;}
+   // Mean of the evalReturn column over the rows written so far
+   double getMeanEvalReturn() const;
+
+   // Whether config's output already holds a finished run with exactly these
+   // settings, written by this build
+   static bool isComplete(const Config& config);
+
+  protected:
+   friend class Lockstep;
+
+   // Accumulated over the learning episode, reported after the evaluation episode
+   struct IterationStats {
+      IterationStats(std::size_t horizon);
+
+      std::vector<double> uncSum;
+      std::vector<double> tgtSum;
+      std::vector<double> uncXtgt;
+      std::vector<double> uncXunc;
+      std::vector<double> tgtXtgt;
+      std::vector<std::size_t> nonInf;
+
+      std::vector<rlfloat_t> stateError;
+      std::vector<rlfloat_t> rwdError;
+      std::vector<rlfloat_t> termError;
+      std::vector<rlfloat_t> predError;
+      std::vector<rlfloat_t> targetError;
+      std::vector<std::vector<rlfloat_t> > uncertaintyErrors;
+      std::vector<rlfloat_t> uncertaintyError;
+      std::vector<std::size_t> numInf;
+      std::vector<std::size_t> numNegInf;
+
+      std::size_t learnFrames;
+      // Of the learning frames, those that had their errors measured
+      std::size_t measuredFrames;
+      double effectiveHorizon;
+   };
+
+   // One learning episode followed by one evaluation episode, then a result row
+   virtual void runIteration();
+   virtual void runEpisode(bool eval);
+   virtual void writeHeader();
+   virtual State getInitialState();
+   virtual State getInitialState(RNG& rng) const;
+   // A fresh copy of the environment being learned in
+   virtual PredictionModel* makeEnvironment(RNG& rng) const;
+
+   // With eval_episodes set, each iteration's evaluation episodes are run on
+   // other threads with a snapshot of the Q-function, while the next learning
+   // episode goes on; the row is written once they are done
+   struct EvalResult {
+      rlfloat_t score;
+      rlfloat_t discountedReturn;
+      std::size_t numFrames;
+   };
+   struct ResultCell {
+      ResultColumnType type;
+      double floatValue;
+      std::size_t intValue;
+   };
+   void startEvals(std::vector<ResultCell>& row, std::size_t evalColumn);
+   void finishEvals();
+   EvalResult runEvalEpisode(const QFunction& qFunc, unsigned seed) const;
+
+   act_t chooseAction(const State& state, bool eval);
+   void beginEpisode();
+   void recordReward(rlfloat_t r, bool eval);
+   void planningUpdate(const Trajectory& traj, std::size_t t, QLearner::Measurements& measurements);
+   // Whether the current frame is one of those measure_every and
+   // measure_fraction pick to have its errors measured
+   bool measuresFrame() const;
+   void recordMeasurements(const QLearner::Measurements& measurements);
+   void recordPlanTime(double planTime);
+   // With replay_experience set, learning episodes take their steps from the
+   // file instead of the environment; both exit if the run strays from it
+   void checkReplayStart(const State& state) const;
+   void replayStep(std::size_t t, act_t action, State& resultState, rlfloat_t& reward, bool& terminated) const;
+   // With latency_hist set, each learning frame's phases are timed separately
+   enum LatencyPhase {actLatency, planLatency, learnLatency, splitLatency, numLatencies};
+   void recordLatency(LatencyPhase phase, std::chrono::high_resolution_clock::duration time);
+   // The whole run's histograms, to <output>.hist
+   void writeHistograms();
+   // The contents of <output>.heartbeat; called on the heartbeat's thread
+   std::string getHeartbeatStatus();
+   // With perf_counters set, the hardware counters run only while these
+   // bracket the planning and model-update phases of learning episodes
+   void startCounters();
+   void stopCounters();
+   // Counters (and allocation counts) only see the thread that opened them,
+   // and a paused run may be continued on another thread
+   void openCounters();
+   // Whether this planner feeds the learned model, and whether it ever plans with it
+   bool trainsModel() const;
+   bool updatesModel() const;
+   void writeEpisode(bool eval, double epTime);
+   // The columns computed from the learning episode's measurements
+   void writeStats();
+
+   // Each value goes to the .result table and, if requested, the binary file,
+   // when the row is ended
+   void addColumn(const std::string& name, ResultColumnType type);
+   void writeColumn(double value);
+   void writeColumn(std::size_t value);
+   void endRow();
+   // Marks the results as finished; see isComplete()
+   void writeFooter();
+
+   std::string getCheckpointName() const;
+   std::string getCheckpointKey() const;
+   virtual void saveCheckpoint();
+   virtual void loadCheckpoint();
+
+   const Config config_;
+   std::ofstream out_;
+
+   RNG initRNG_;
+   RNG rng_;
+
+   const Planner& planner_;
+   std::string game_;
+
+   PredictionModel* env_;
+   BBIPredictionModel* uncertainEnv_;
+   QFunction* qFunc_;
+   std::size_t stateDim_;
+   act_t numActions_;
+   std::vector<Bound> dimRanges_;
+
+   QLearner* agent_;
+   LearnedModel* model_;
+   BBIPredictionModel* planningModel_;
+
+   bool modelUpdated_;
+   std::vector<Trajectory*> data_;
+
+   double totalTime_;
+   double totalPlanTime_;
+   std::size_t totalFrames_;
+   std::size_t framesSinceSplit_;
+
+   IterationStats stats_;
+   // The current frame's, emptied and refilled every frame to keep its storage
+   QLearner::Measurements measurements_;
+   std::size_t numFrames_;
+   rlfloat_t epReward_;
+   rlfloat_t epReturn_;
+   rlfloat_t totalDiscount_;
+   double epPlanTime_;
+
+   std::size_t horizon_;
+   std::size_t padW_;
+   std::size_t numColumns_;
+   ResultWriter* binOut_;
+   ExperienceWriter* recorder_;
+   ExperienceReader* replay_;
+
+   std::vector<ResultCell> row_;
+   std::vector<ResultCell> pendingRow_;
+   std::size_t evalColumn_;
+   std::vector<std::future<EvalResult> > pendingEvals_;
+
+   std::size_t lastCheckpoint_;
+
+   double evalReturnTotal_;
+   std::size_t numEvals_;
+
+   PerfCounters* perf_;
+   // The counts when the last row was written
+   std::vector<double> perfCounts_;
+   std::vector<double> allocCounts_;
+
+   // Since the last row, and over the whole run
+   std::vector<LatencyHistogram> epLatency_;
+   std::vector<LatencyHistogram> runLatency_;
+
+   // Published by the run for the heartbeat thread to read
+   std::atomic<std::size_t> liveFrames_;
+   std::atomic<std::size_t> liveLeaves_;
+   std::atomic<double> liveEvalReturn_;
+   // Used only by the heartbeat thread
+   std::size_t beatFrames_;
+   std::chrono::steady_clock::time_point beatTime_;
+   Heartbeat* heartbeat_;
+};
+
+#endif
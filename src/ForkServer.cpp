@@ -0,0 +1,225 @@
+#include "ForkServer.hpp"
+
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <cstdlib>
+#include <csignal>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+// SIGCHLD writes a byte here so that poll() wakes up as soon as a job ends
+static int childPipe[2] = {-1, -1};
+
+static void onChildExit(int) {
+   int savedErrno = errno;
+   char byte = 0;
+   if (write(childPipe[1], &byte, 1) < 0) {
+      // The pipe is full, so poll() will wake up anyway
+   }
+   errno = savedErrno;
+}
+
+ForkServer::ForkServer(const string& path, size_t maxChildren) :
+   path_(path),
+   maxChildren_(maxChildren),
+   isFifo_(false),
+   listenFd_(-1),
+   stopping_(false) {
+   struct stat info;
+   bool exists = stat(path_.c_str(), &info) == 0;
+   if (exists and S_ISFIFO(info.st_mode)) {
+      // Also opened for writing, so the FIFO never reads as closed between writers
+      isFifo_ = true;
+      listenFd_ = open(path_.c_str(), O_RDWR);
+      if (listenFd_ < 0) {
+	 cerr << "Could not open FIFO: " << path_ << endl;
+	 exit(1);
+      }
+      return;
+   }
+
+   sockaddr_un addr;
+   memset(&addr, 0, sizeof(addr));
+   addr.sun_family = AF_UNIX;
+   if (path_.size() >= sizeof(addr.sun_path)) {
+      cerr << "Socket path is too long: " << path_ << endl;
+      exit(1);
+   }
+   strcpy(addr.sun_path, path_.c_str());
+
+   if (exists) {
+      if (!S_ISSOCK(info.st_mode)) {
+	 cerr << "Not a FIFO or a socket: " << path_ << endl;
+	 exit(1);
+      }
+      // Left behind by an earlier server
+      unlink(path_.c_str());
+   }
+
+   listenFd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+   if (listenFd_ < 0 or
+       bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 or
+       listen(listenFd_, 16) != 0) {
+      cerr << "Could not listen on socket: " << path_ << endl;
+      exit(1);
+   }
+}
+
+ForkServer::~ForkServer() {
+   for (auto fd : clientFds_) {
+      close(fd);
+   }
+   close(listenFd_);
+   if (!isFifo_) {
+      unlink(path_.c_str());
+   }
+}
+
+void ForkServer::serve(const function<void(const string&)>& runJob) {
+   if (pipe(childPipe) != 0) {
+      cerr << "Could not create a pipe" << endl;
+      exit(1);
+   }
+   fcntl(childPipe[0], F_SETFL, O_NONBLOCK);
+   fcntl(childPipe[1], F_SETFL, O_NONBLOCK);
+   struct sigaction action;
+   memset(&action, 0, sizeof(action));
+   action.sa_handler = onChildExit;
+   action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+   sigaction(SIGCHLD, &action, nullptr);
+
+   cerr << "Serving jobs from " << path_ << endl;
+   while (!stopping_ or !pending_.empty() or !children_.empty()) {
+      reapChildren();
+      startJobs(runJob);
+      if (stopping_ and pending_.empty() and children_.empty()) {
+	 break;
+      }
+
+      vector<pollfd> fds;
+      fds.push_back({childPipe[0], POLLIN, 0});
+      fds.push_back({listenFd_, POLLIN, 0});
+      for (auto fd : clientFds_) {
+	 fds.push_back({fd, POLLIN, 0});
+      }
+      if (poll(fds.data(), fds.size(), -1) < 0) {
+	 if (errno == EINTR) {
+	    continue;
+	 }
+	 cerr << "poll failed while serving " << path_ << endl;
+	 exit(1);
+      }
+
+      if (fds[0].revents) {
+	 char buffer[64];
+	 while (read(childPipe[0], buffer, sizeof(buffer)) > 0) {
+	 }
+      }
+      if (fds[1].revents) {
+	 if (isFifo_) {
+	    readLines(listenFd_);
+	 } else {
+	    int client = accept(listenFd_, nullptr, nullptr);
+	    if (client >= 0) {
+	       clientFds_.push_back(client);
+	    }
+	 }
+      }
+      for (size_t f = 2; f < fds.size(); ++f) {
+	 if (fds[f].revents) {
+	    readLines(fds[f].fd);
+	 }
+      }
+   }
+
+   signal(SIGCHLD, SIG_DFL);
+   close(childPipe[0]);
+   close(childPipe[1]);
+}
+
+void ForkServer::readLines(int fd) {
+   char buffer[4096];
+   ssize_t n = read(fd, buffer, sizeof(buffer));
+   if (n <= 0) {
+      // A client hung up; a FIFO opened for writing never gets here
+      close(fd);
+      clientFds_.erase(find(clientFds_.begin(), clientFds_.end(), fd));
+      partialLines_.erase(fd);
+      return;
+   }
+
+   string& data = partialLines_[fd];
+   data.append(buffer, n);
+   size_t lineEnd;
+   while ((lineEnd = data.find('\n')) != string::npos) {
+      string line = data.substr(0, lineEnd);
+      data.erase(0, lineEnd + 1);
+
+      line.erase(0, line.find_first_not_of(" \t\r"));
+      line.erase(line.find_last_not_of(" \t\r") + 1);
+      if (line.empty() or line[0] == '#') {
+	 continue;
+      }
+      if (line == "exit") {
+	 stopping_ = true;
+      } else if (!stopping_) {
+	 pending_.push_back(line);
+      }
+   }
+}
+
+void ForkServer::startJobs(const function<void(const string&)>& runJob) {
+   while (!pending_.empty() and children_.size() < maxChildren_) {
+      string job = pending_.front();
+      pending_.pop_front();
+
+      // Anything still buffered would otherwise be written by the child too
+      cout.flush();
+      cerr.flush();
+      pid_t pid = fork();
+      if (pid < 0) {
+	 cerr << "fork failed for job: " << job << endl;
+	 exit(1);
+      }
+      if (pid == 0) {
+	 signal(SIGCHLD, SIG_DFL);
+	 close(childPipe[0]);
+	 close(childPipe[1]);
+	 close(listenFd_);
+	 for (auto fd : clientFds_) {
+	    close(fd);
+	 }
+	 runJob(job);
+	 exit(0);
+      }
+      children_[pid] = job;
+   }
+}
+
+void ForkServer::reapChildren() {
+   int status;
+   pid_t pid;
+   while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+      auto child = children_.find(pid);
+      if (child == children_.end()) {
+	 continue;
+      }
+      if (WIFEXITED(status) and WEXITSTATUS(status) == 0) {
+	 cerr << "[done] " << child->second << endl;
+      } else if (WIFEXITED(status)) {
+	 cerr << "[failed with status " << WEXITSTATUS(status) << "] " << child->second << endl;
+      } else {
+	 cerr << "[killed by signal " << WTERMSIG(status) << "] " << child->second << endl;
+      }
+      children_.erase(child);
+   }
+}
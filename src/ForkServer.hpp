@@ -0,0 +1,48 @@
+#ifndef FORKSERVER_HPP
+#define FORKSERVER_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <functional>
+#include <cstddef>
+#include <sys/types.h>
+
+// Runs jobs named on a FIFO or a unix socket, one per line, each in its own
+// fork()ed child. The children start from the parent's address space, so the
+// dynamic loading and static initialization (libtorch's above all) are paid
+// once for the whole session rather than once per run.
+//
+// If path names an existing FIFO, lines are read from it; otherwise a unix
+// stream socket is created at path and any number of clients may connect and
+// write lines. Blank lines and lines starting with # are ignored, and a line
+// reading "exit" makes the server finish its queued jobs and return.
+class ForkServer {
+  public:
+   ForkServer(const std::string& path, std::size_t maxChildren);
+   virtual ~ForkServer();
+
+   ForkServer(const ForkServer&) = delete;
+   ForkServer& operator=(const ForkServer&) = delete;
+
+   // Calls runJob(line) in a child process for every job received
+   virtual void serve(const std::function<void(const std::string&)>& runJob);
+
+  protected:
+   void readLines(int fd);
+   void startJobs(const std::function<void(const std::string&)>& runJob);
+   void reapChildren();
+
+   std::string path_;
+   std::size_t maxChildren_;
+   bool isFifo_;
+   int listenFd_;
+   std::vector<int> clientFds_;
+   std::map<int, std::string> partialLines_;
+   std::deque<std::string> pending_;
+   std::map<pid_t, std::string> children_;
+   bool stopping_;
+};
+
+#endif
@@ -0,0 +1,263 @@
+#include "Lockstep.hpp"
+#include "dout.hpp"
+#include "Trace.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <chrono>
+
+using namespace std;
+
+string Lockstep::getStreamKey(const Config& config) {
+   // Otherwise the behavior policy depends on the agent
+   if (config.explorationRate != 1) {
+      return "";
+   }
+   // Checkpoints cover a single run's state only
+   if (config.checkpointEvery > 0 or config.resume) {
+      return "";
+   }
+   // Lockstep evaluates in line, one episode per run
+   if (config.evalEpisodes > 0) {
+      return "";
+   }
+
+   ostringstream key;
+   key << config.game << " "
+       << config.seed << " "
+       << config.numFrames << " "
+       << config.gorLength << " "
+       << config.gorNumInd << " "
+       << config.gorPrizeMult << " "
+       << config.updateEvery << " "
+       << config.predictChange << " "
+       << config.useNN << " "
+       << config.replayExperience << " ";
+   if (config.useNN) {
+      key << Planner::get(config.planner).getTrainingType(config) << " "
+	  << config.hiddenSize << " "
+	  << config.nnStepSize << " "
+	  << config.batchSize << " "
+	  << config.varianceSmoothing;
+   } else {
+      key << config.maxLeaves << " "
+	  << config.splitConfidence << " "
+	  << config.tieThreshold;
+   }
+   // The A planner gives GoRight models an extra state dimension
+   if (config.game == "GR") {
+      key << " " << (config.planner == "A");
+   }
+   return key.str();
+}
+
+Lockstep::Lockstep(const vector<Config>& configs) :
+   trainsModel_(false),
+   updatesModel_(false) {
+   if (configs.empty()) {
+      cerr << "Lockstep needs at least one run." << endl;
+      exit(1);
+   }
+
+   string key = getStreamKey(configs[0]);
+   if (key.empty()) {
+      cerr << "Lockstep runs need an exploration rate of 1, no checkpoints, and no eval_episodes: " << configs[0].output << endl;
+      exit(1);
+   }
+   for (auto& config : configs) {
+      if (getStreamKey(config) != key) {
+	 cerr << "Run " << config.output << " cannot share an experience stream with " << configs[0].output << endl;
+	 exit(1);
+      }
+      runs_.push_back(new Experiment(config));
+   }
+
+   // The first run's environment, trajectories, and model are shared by all
+   lead_ = runs_[0];
+   for (auto run : runs_) {
+      trainsModel_ = trainsModel_ or run->trainsModel();
+      updatesModel_ = updatesModel_ or run->updatesModel();
+      if (run != lead_) {
+	 if (run->planningModel_ != run->uncertainEnv_) {
+	    run->planningModel_ = dynamic_cast<BBIPredictionModel*>(lead_->model_);
+	 }
+	 delete run->model_;
+	 run->model_ = nullptr;
+      }
+   }
+}
+
+Lockstep::~Lockstep() {
+   // The lead owns the shared model, so it goes last
+   for (size_t i = runs_.size(); i > 0; --i) {
+      delete runs_[i-1];
+   }
+}
+
+void Lockstep::run() {
+   for (auto run : runs_) {
+      run->openCounters();
+   }
+   while (lead_->totalFrames_ < lead_->config_.numFrames) {
+      runIteration();
+   }
+   for (auto run : runs_) {
+      run->writeFooter();
+   }
+}
+
+void Lockstep::runIteration() {
+   for (auto run : runs_) {
+      run->stats_ = Experiment::IterationStats(run->horizon_);
+   }
+
+   runLearningEpisode();
+
+   // Evaluation draws the same random numbers no matter the policy, so every
+   // run starts from the lead's RNG state and they all end up in step again
+   RNG evalRNG = lead_->rng_;
+   for (auto run : runs_) {
+      run->rng_ = evalRNG;
+      run->runEpisode(true);
+      run->endRow();
+   }
+}
+
+void Lockstep::runLearningEpisode() {
+   ALLOC_PHASE(AllocStats::act);
+   for (auto run : runs_) {
+      run->beginEpisode();
+   }
+
+   State curState = lead_->getInitialState();
+
+   bool terminated = false;
+
+   lead_->data_.push_back(new Trajectory(curState, terminated));
+   Trajectory& curTraj = *lead_->data_.back();
+   if (lead_->replay_) {
+      lead_->checkReplayStart(curState);
+   }
+
+   auto epStart = chrono::high_resolution_clock::now();
+
+   for (size_t t = 0; t < 500 and !terminated; ++t) {
+      auto actStart = chrono::high_resolution_clock::now();
+      act_t action = lead_->chooseAction(curState, false);
+
+      State resultState;
+
+      DOUT << "Frame: " << lead_->totalFrames_ << " Episode Step " << t << ": ";
+      for (auto d : curState) {
+	 DOUT << d << " ";
+      }
+      DOUT << " action: " << action << endl;
+
+      rlfloat_t r;
+      if (lead_->replay_) {
+	 lead_->replayStep(t, action, resultState, r, terminated);
+      } else {
+	 {
+	    TRACE_SCOPE("envStep");
+	    lead_->env_->getStatePrediction(curState, action, resultState);
+	 }
+	 r = lead_->env_->getRewardPrediction(curState, action);
+	 terminated = lead_->env_->getTermPrediction(curState, action) > 0.5;
+      }
+      for (auto run : runs_) {
+	 run->recordReward(r, false);
+      }
+
+      curTraj.addStep(action, r, resultState, terminated);
+
+      auto actTime = chrono::high_resolution_clock::now() - actStart;
+      for (auto run : runs_) {
+	 run->recordLatency(Experiment::actLatency, actTime);
+      }
+
+      for (auto run : runs_) {
+	 QLearner::Measurements measurements;
+
+	 auto planStart = chrono::high_resolution_clock::now();
+	 run->startCounters();
+	 run->planningUpdate(curTraj, t, measurements);
+	 run->stopCounters();
+	 auto planEnd = chrono::high_resolution_clock::now();
+	 run->recordPlanTime(chrono::duration_cast<chrono::duration<double>>(planEnd - planStart).count());
+	 run->recordLatency(Experiment::planLatency, planEnd - planStart);
+
+	 run->recordMeasurements(measurements);
+	 ++run->totalFrames_;
+	 run->liveFrames_.store(run->totalFrames_, memory_order_relaxed);
+      }
+
+      if (trainsModel_) {
+	 ALLOC_PHASE(AllocStats::modelLearn);
+	 auto trainStart = chrono::high_resolution_clock::now();
+	 for (auto run : runs_) {
+	    if (run->trainsModel()) {
+	       run->startCounters();
+	    }
+	 }
+	 lead_->model_->addExample(curTraj, t);
+	 for (auto run : runs_) {
+	    if (run->trainsModel()) {
+	       run->stopCounters();
+	    }
+	 }
+	 auto trainEnd = chrono::high_resolution_clock::now();
+	 // Charged to every run that would have paid it alone
+	 double trainTime = chrono::duration_cast<chrono::duration<double>>(trainEnd - trainStart).count();
+	 for (auto run : runs_) {
+	    if (run->trainsModel()) {
+	       run->recordPlanTime(trainTime);
+	       run->recordLatency(Experiment::learnLatency, trainEnd - trainStart);
+	    }
+	 }
+      }
+
+      ++lead_->framesSinceSplit_;
+
+      if (updatesModel_ and
+	  lead_->framesSinceSplit_ >= lead_->config_.updateEvery) {
+	 ALLOC_PHASE(AllocStats::modelSplit);
+	 DOUT << "Updating Model " << lead_->totalFrames_ << endl;
+	 auto splitStart = chrono::high_resolution_clock::now();
+	 for (auto run : runs_) {
+	    if (run->updatesModel()) {
+	       run->startCounters();
+	    }
+	 }
+	 lead_->model_->updatePredictions();
+	 for (auto run : runs_) {
+	    if (run->updatesModel()) {
+	       run->stopCounters();
+	    }
+	 }
+	 auto splitTime = chrono::high_resolution_clock::now() - splitStart;
+	 for (auto run : runs_) {
+	    if (run->updatesModel()) {
+	       run->recordLatency(Experiment::splitLatency, splitTime);
+	    }
+	 }
+	 lead_->framesSinceSplit_ = 0;
+	 size_t numLeaves = lead_->model_->getNumLeaves();
+	 for (auto run : runs_) {
+	    run->modelUpdated_ = true;
+	    run->liveLeaves_.store(numLeaves, memory_order_relaxed);
+	 }
+      }
+
+      curState = resultState;
+   }
+
+   auto epEnd = chrono::high_resolution_clock::now();
+   auto epTime = chrono::duration_cast<chrono::duration<double>>(epEnd - epStart).count();
+   for (auto run : runs_) {
+      run->totalTime_ += epTime;
+      if (run->recorder_) {
+	 run->recorder_->write(curTraj);
+      }
+      run->writeEpisode(false, epTime);
+   }
+}
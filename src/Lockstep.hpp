@@ -0,0 +1,44 @@
+#ifndef LOCKSTEP_HPP
+#define LOCKSTEP_HPP
+
+#include "Experiment.hpp"
+#include "Config.hpp"
+
+#include <string>
+#include <vector>
+
+// Runs several Experiments off a single experience stream. With an
+// exploration rate of 1 the behavior policy never consults the agent, so runs
+// that share a seed, environment, and model settings see the same learning
+// trajectories. The environment is stepped and the model trained once per
+// frame, then every run's agent does its own planning update. Each run still
+// evaluates on its own copy of the environment and writes its own .result file.
+//
+// Runs that plan with an oracle model, or that do not sample, get the same
+// results as they would alone. Runs that sample from the shared learned model
+// draw from one RNG in turn, so they match their solo runs in distribution
+// only.
+class Lockstep {
+  public:
+   Lockstep(const std::vector<Config>& configs);
+   virtual ~Lockstep();
+
+   Lockstep(const Lockstep&) = delete;
+   Lockstep& operator=(const Lockstep&) = delete;
+
+   virtual void run();
+
+   // Runs whose configs have the same (non-empty) key can share a stream
+   static std::string getStreamKey(const Config& config);
+
+  protected:
+   virtual void runIteration();
+   virtual void runLearningEpisode();
+
+   std::vector<Experiment*> runs_;
+   Experiment* lead_;
+   bool trainsModel_;
+   bool updatesModel_;
+};
+
+#endif
@@ -0,0 +1,171 @@
+#include "WorkQueue.hpp"
+#include "Hash.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+WorkQueue::WorkQueue(const string& dir, double leaseTimeout) :
+   dir_(dir),
+   leaseTimeout_(leaseTimeout),
+   numTemps_(0),
+   stopping_(false) {
+   error_code err;
+   filesystem::create_directories(dir_, err);
+   if (!filesystem::is_directory(dir_)) {
+      cerr << "Could not create queue directory: " << dir_ << endl;
+      exit(1);
+   }
+   if (leaseTimeout_ <= 0) {
+      cerr << "The lease timeout must be positive." << endl;
+      exit(1);
+   }
+
+   char host[256] = {0};
+   gethostname(host, sizeof(host) - 1);
+   workerName_ = string(host) + "." + to_string(getpid());
+
+   heartbeatThread_ = thread(&WorkQueue::heartbeat, this);
+}
+
+WorkQueue::~WorkQueue() {
+   {
+      lock_guard<mutex> lock(mutex_);
+      stopping_ = true;
+   }
+   stopSignal_.notify_all();
+   heartbeatThread_.join();
+}
+
+// Readable, but unique per job however long or odd the job's name is
+string WorkQueue::getFilename(const string& job, const string& ext) const {
+   ostringstream name;
+   name << filesystem::path(job).filename().string() << "." << hex << setw(16) << setfill('0') << fnv1a(job);
+   return (filesystem::path(dir_) / (name.str() + ext)).string();
+}
+
+bool WorkQueue::isDone(const string& job) const {
+   return filesystem::exists(getFilename(job, ".done"));
+}
+
+bool WorkQueue::claim(const string& job) {
+   if (isDone(job)) {
+      return false;
+   }
+   if (link(job)) {
+      return true;
+   }
+   return reclaimIfStale(job) and link(job);
+}
+
+bool WorkQueue::link(const string& job) {
+   string leaseName = getFilename(job, ".lease");
+   string tempName;
+   {
+      lock_guard<mutex> lock(mutex_);
+      tempName = leaseName + "." + workerName_ + "." + to_string(numTemps_++);
+   }
+
+   ofstream tempOut(tempName);
+   if (!tempOut.is_open()) {
+      cerr << "Could not write to queue directory: " << dir_ << endl;
+      exit(1);
+   }
+   tempOut << workerName_ << " " << time(nullptr) << " " << job << endl;
+   tempOut.close();
+
+   // link() is atomic even over NFS, but its reply can be lost, so success is
+   // judged by the link count
+   ::link(tempName.c_str(), leaseName.c_str());
+   struct stat info;
+   bool linked = stat(tempName.c_str(), &info) == 0 and info.st_nlink == 2;
+   unlink(tempName.c_str());
+
+   if (linked) {
+      lock_guard<mutex> lock(mutex_);
+      held_.insert(leaseName);
+      observed_.erase(leaseName);
+   }
+   return linked;
+}
+
+bool WorkQueue::reclaimIfStale(const string& job) {
+   string leaseName = getFilename(job, ".lease");
+   struct stat info;
+   if (stat(leaseName.c_str(), &info) != 0) {
+      // Released since we tried to link
+      return true;
+   }
+
+   time_t now = time(nullptr);
+   {
+      lock_guard<mutex> lock(mutex_);
+      auto seen = observed_.find(leaseName);
+      if (seen == observed_.end() or
+	  seen->second.first.tv_sec != info.st_mtim.tv_sec or
+	  seen->second.first.tv_nsec != info.st_mtim.tv_nsec) {
+	 observed_[leaseName] = {info.st_mtim, now};
+	 return false;
+      }
+      if (difftime(now, seen->second.second) < leaseTimeout_) {
+	 return false;
+      }
+      observed_.erase(seen);
+   }
+
+   // Only one worker's rename can succeed
+   string staleName = leaseName + ".stale." + workerName_;
+   if (rename(leaseName.c_str(), staleName.c_str()) != 0) {
+      return false;
+   }
+   cerr << "Reclaiming stale lease for " << job << endl;
+   unlink(staleName.c_str());
+   return true;
+}
+
+void WorkQueue::complete(const string& job) {
+   string doneName = getFilename(job, ".done");
+   ofstream doneOut(doneName);
+   if (!doneOut.is_open()) {
+      cerr << "Could not write to queue directory: " << dir_ << endl;
+      exit(1);
+   }
+   doneOut << workerName_ << " " << time(nullptr) << " " << job << endl;
+   doneOut.close();
+
+   release(job);
+}
+
+void WorkQueue::release(const string& job) {
+   string leaseName = getFilename(job, ".lease");
+   {
+      lock_guard<mutex> lock(mutex_);
+      held_.erase(leaseName);
+   }
+   unlink(leaseName.c_str());
+}
+
+void WorkQueue::heartbeat() {
+   auto interval = chrono::duration<double>(leaseTimeout_/4);
+   unique_lock<mutex> lock(mutex_);
+   while (!stopSignal_.wait_for(lock, interval, [this]() {return stopping_;})) {
+      for (auto lease = held_.begin(); lease != held_.end();) {
+	 // A null time is set by the file server, not by our own clock
+	 if (utimensat(AT_FDCWD, lease->c_str(), nullptr, 0) != 0) {
+	    cerr << "Lost the lease " << *lease << "; its job may run twice" << endl;
+	    lease = held_.erase(lease);
+	 } else {
+	    ++lease;
+	 }
+      }
+   }
+}
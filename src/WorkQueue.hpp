@@ -0,0 +1,64 @@
+#ifndef WORKQUEUE_HPP
+#define WORKQUEUE_HPP
+
+#include <string>
+#include <set>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <ctime>
+#include <cstddef>
+
+// Lets any number of processes, on any number of machines that share dir
+// (over NFS, say), divide one list of jobs among themselves with no server.
+//
+// A job is claimed by hard-linking a freshly written lease file to
+// <dir>/<job>.lease, which succeeds for exactly one worker even over NFS.
+// While a job runs a background thread keeps touching its lease. A lease
+// whose modification time has not moved for leaseTimeout seconds, as timed
+// by the worker looking at it (so clocks need not agree), belongs to a dead
+// worker; it is renamed away, which again only one worker can do, and the job
+// is claimed afresh. A finished job gets a <job>.done file before its lease
+// is removed, so a job is never lost, and it is only run twice if its worker
+// stops heartbeating for a whole timeout while still alive.
+class WorkQueue {
+  public:
+   WorkQueue(const std::string& dir, double leaseTimeout);
+   virtual ~WorkQueue();
+
+   WorkQueue(const WorkQueue&) = delete;
+   WorkQueue& operator=(const WorkQueue&) = delete;
+
+   virtual bool isDone(const std::string& job) const;
+   // Returns true if this worker now holds the job's lease
+   virtual bool claim(const std::string& job);
+   // Marks a claimed job finished and gives up its lease
+   virtual void complete(const std::string& job);
+   // Gives up the lease without marking the job finished
+   virtual void release(const std::string& job);
+
+   double getLeaseTimeout() const {return leaseTimeout_;}
+
+  protected:
+   std::string getFilename(const std::string& job, const std::string& ext) const;
+   bool link(const std::string& job);
+   bool reclaimIfStale(const std::string& job);
+   void heartbeat();
+
+   std::string dir_;
+   double leaseTimeout_;
+   std::string workerName_;
+
+   mutable std::mutex mutex_;
+   std::set<std::string> held_;
+   // lease filename -> (last modification time seen, local time it was first seen)
+   std::map<std::string, std::pair<std::timespec, std::time_t> > observed_;
+   std::size_t numTemps_;
+
+   bool stopping_;
+   std::condition_variable stopSignal_;
+   std::thread heartbeatThread_;
+};
+
+#endif
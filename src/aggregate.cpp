@@ -0,0 +1,351 @@
+#include "MappedFile.hpp"
+#include "ResultFile.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <regex>
+#include <cmath>
+#include <cctype>
+#include <cstdlib>
+#include <limits>
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+#include <atomic>
+#include <cxxopts.hpp>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// Summarizes a parameter sweep and selects the best step size (and
+// temperature) for every configuration, replacing best_gor_params.py and
+// best_acro_params.py.
+//
+// Result files are expected to be named <family>.a<step size>[.m<temp>].t<trial>.result,
+// as the generate_*_cfgs.py scripts produce. For each family the selected
+// setting is the one with the largest area under its learning curve among
+// those whose final performance is at least that of the best baseline (Q by
+// default) setting in the same directory; if none are, it is the one with the
+// best final performance. The baseline family used is the one whose name
+// shares the longest prefix with the family's. One glob per family is printed
+// in the format generate_selected_configs.py reads, and per-setting
+// statistics go to cerr.
+
+cxxopts::ParseResult parseOptions(int argc, char* argv[]) {
+   cxxopts::Options options("aggregate", "Select the best metaparameters from a sweep's result files.");
+   options.add_options()
+      ("path", "Directory searched (recursively) for result files", cxxopts::value<string>()->default_value("./"))
+      ("column", "Result column whose learning curve is evaluated", cxxopts::value<string>()->default_value("evalReturn"))
+      ("window", "Number of final rows averaged for the final performance", cxxopts::value<size_t>()->default_value("100"))
+      ("baseline", "Planner whose best final performance sets the benchmark", cxxopts::value<string>()->default_value("Q"))
+      ("j,jobs", "Number of files to read at once (0 for one per core)", cxxopts::value<size_t>()->default_value("0"));
+
+   return options.parse(argc, argv);
+}
+
+struct TrialSummary {
+   size_t numRows;
+   double finalPerf;     // Mean of the last window rows
+   double area;          // Sum of the means of every full trailing window
+   double effHoriz;      // In the last row
+   double fps;           // In the last row
+};
+
+struct SettingSummary {
+   string setting;
+   string glob;
+   size_t numTrials;
+   double finalMean;
+   double finalCI;       // Half-width of the 95% confidence interval
+   double area;
+   double effHoriz;
+   double fps;
+};
+
+static TrialSummary summarizeCurve(const vector<double>& curve, double effHoriz, double fps, size_t window) {
+   TrialSummary trial {curve.size(), 0, 0, effHoriz, fps};
+   if (curve.size() < window) {
+      return trial;
+   }
+
+   vector<double> cumSum(curve.size() + 1, 0);
+   for (size_t r = 0; r < curve.size(); ++r) {
+      cumSum[r + 1] = cumSum[r] + curve[r];
+   }
+   for (size_t end = window; end <= curve.size(); ++end) {
+      trial.area += (cumSum[end] - cumSum[end - window])/window;
+   }
+   trial.finalPerf = (cumSum[curve.size()] - cumSum[curve.size() - window])/window;
+   return trial;
+}
+
+static size_t findColumn(const vector<string>& names, const string& name, const string& filename) {
+   auto col = find(names.begin(), names.end(), name);
+   if (col == names.end()) {
+      cerr << "No column " << name << " in " << filename << endl;
+      exit(1);
+   }
+   return col - names.begin();
+}
+
+static TrialSummary readTextResult(const string& filename, const string& column, size_t window) {
+   MappedFile file(filename);
+   const char* begin = reinterpret_cast<const char*>(file.data());
+   const char* end = begin + file.size();
+
+   // Header entries look like 10_evalReturn
+   const char* lineEnd = find(begin, end, '\n');
+   vector<string> names;
+   const char* pos = begin;
+   while (pos < lineEnd) {
+      while (pos < lineEnd and isspace(*pos)) {
+	 ++pos;
+      }
+      const char* nameEnd = pos;
+      while (nameEnd < lineEnd and !isspace(*nameEnd)) {
+	 ++nameEnd;
+      }
+      if (nameEnd > pos) {
+	 string name(pos, nameEnd);
+	 names.push_back(name.substr(name.find('_') + 1));
+      }
+      pos = nameEnd;
+   }
+   if (lineEnd == end) {
+      return TrialSummary {0, 0, 0, 0, 0};
+   }
+
+   size_t curveCol = findColumn(names, column, filename);
+   size_t effHorizCol = findColumn(names, "effHoriz", filename);
+   size_t fpsCol = findColumn(names, "totalFPS", filename);
+   size_t lastCol = max(curveCol, max(effHorizCol, fpsCol));
+
+   vector<double> curve;
+   double effHoriz = 0;
+   double fps = 0;
+   pos = lineEnd + 1;
+   // A trailing line without a newline is a row still being written
+   while ((lineEnd = find(pos, end, '\n')) != end) {
+      // Comment lines such as the completion footer are not rows
+      if (*pos == '#') {
+	 pos = lineEnd + 1;
+	 continue;
+      }
+      char* next = const_cast<char*>(pos);
+      for (size_t c = 0; c <= lastCol and next < lineEnd; ++c) {
+	 double val = strtod(next, &next);
+	 if (c == curveCol) {
+	    curve.push_back(val);
+	 } else if (c == effHorizCol) {
+	    effHoriz = val;
+	 } else if (c == fpsCol) {
+	    fps = val;
+	 }
+      }
+      pos = lineEnd + 1;
+   }
+
+   return summarizeCurve(curve, effHoriz, fps, window);
+}
+
+static TrialSummary readBinaryResult(const string& filename, const string& column, size_t window) {
+   ResultReader reader(filename);
+   size_t curveCol = reader.getColumnIndex(column);
+   size_t effHorizCol = reader.getColumnIndex("effHoriz");
+   size_t fpsCol = reader.getColumnIndex("totalFPS");
+   if (curveCol == reader.getNumColumns() or effHorizCol == reader.getNumColumns() or fpsCol == reader.getNumColumns()) {
+      cerr << "Missing a required column in " << filename << endl;
+      exit(1);
+   }
+
+   size_t numRows = reader.getNumRows();
+   vector<double> curve(numRows);
+   for (size_t r = 0; r < numRows; ++r) {
+      curve[r] = reader.getFloat(r, curveCol);
+   }
+   double effHoriz = numRows > 0 ? reader.getFloat(numRows - 1, effHorizCol) : 0;
+   double fps = numRows > 0 ? reader.getFloat(numRows - 1, fpsCol) : 0;
+   return summarizeCurve(curve, effHoriz, fps, window);
+}
+
+static SettingSummary summarizeSetting(const string& family, const string& name, const vector<TrialSummary>& trials) {
+   SettingSummary setting {name, family + "." + name + ".t*.result", trials.size(), 0, 0, 0, 0, 0};
+   for (auto& trial : trials) {
+      setting.finalMean += trial.finalPerf;
+      setting.area += trial.area;
+      setting.effHoriz += trial.effHoriz;
+      setting.fps += trial.fps;
+   }
+   setting.finalMean /= trials.size();
+   setting.area /= trials.size();
+   setting.effHoriz /= trials.size();
+   setting.fps /= trials.size();
+
+   if (trials.size() > 1) {
+      double sqErr = 0;
+      for (auto& trial : trials) {
+	 sqErr += (trial.finalPerf - setting.finalMean)*(trial.finalPerf - setting.finalMean);
+      }
+      setting.finalCI = 1.96*sqrt(sqErr/(trials.size() - 1)/trials.size());
+   }
+   return setting;
+}
+
+int main(int argc, char* argv[]) {
+   cxxopts::ParseResult result = parseOptions(argc, argv);
+   string path = result["path"].as<string>();
+   string column = result["column"].as<string>();
+   size_t window = result["window"].as<size_t>();
+   string baselineSuffix = ".p" + result["baseline"].as<string>();
+
+   if (window == 0) {
+      cerr << "The window must be at least one row." << endl;
+      exit(1);
+   }
+   if (!fs::is_directory(path)) {
+      cerr << "Not a directory: " << path << endl;
+      exit(1);
+   }
+
+   // A binary result is preferred over the text table of the same run
+   const string textExt = ".result";
+   const string binExt = ".result.bin";
+   map<string, string> runFiles;
+   for (auto& entry : fs::recursive_directory_iterator(path)) {
+      if (!entry.is_regular_file()) {
+	 continue;
+      }
+      string filename = entry.path().string();
+      if (filename.size() > binExt.size() and filename.compare(filename.size() - binExt.size(), binExt.size(), binExt) == 0) {
+	 runFiles[filename.substr(0, filename.size() - binExt.size())] = filename;
+      } else if (filename.size() > textExt.size() and filename.compare(filename.size() - textExt.size(), textExt.size(), textExt) == 0) {
+	 runFiles.emplace(filename.substr(0, filename.size() - textExt.size()), filename);
+      }
+   }
+
+   // <family>.a<step size>[.m<temperature>].t<trial>
+   const regex runName("(.*)\\.(a[^./]+(\\.m[^./]+)?)\\.t[0-9]+");
+   vector<string> filenames;
+   vector<string> families;
+   vector<string> settings;
+   for (auto& run : runFiles) {
+      smatch match;
+      if (!regex_match(run.first, match, runName)) {
+	 cerr << "Skipping " << run.second << ": name has no step size and trial" << endl;
+	 continue;
+      }
+      filenames.push_back(run.second);
+      families.push_back(match[1]);
+      settings.push_back(match[2]);
+   }
+
+   size_t numJobs = result["jobs"].as<size_t>();
+   if (numJobs == 0) {
+      numJobs = max(thread::hardware_concurrency(), 1u);
+   }
+   numJobs = max(min(numJobs, filenames.size()), size_t(1));
+
+   vector<TrialSummary> trials(filenames.size());
+   atomic<size_t> nextFile(0);
+   auto worker = [&]() {
+      size_t f;
+      while ((f = nextFile++) < filenames.size()) {
+	 const string& filename = filenames[f];
+	 if (filename.compare(filename.size() - binExt.size(), binExt.size(), binExt) == 0) {
+	    trials[f] = readBinaryResult(filename, column, window);
+	 } else {
+	    trials[f] = readTextResult(filename, column, window);
+	 }
+      }
+   };
+
+   vector<thread> workers;
+   for (size_t w = 0; w < numJobs; ++w) {
+      workers.emplace_back(worker);
+   }
+   for (auto& w : workers) {
+      w.join();
+   }
+
+   // family -> setting -> trials
+   map<string, map<string, vector<TrialSummary> > > sweep;
+   for (size_t f = 0; f < filenames.size(); ++f) {
+      if (trials[f].numRows < window) {
+	 cerr << filenames[f] << " only has " << trials[f].numRows << " rows!" << endl;
+	 continue;
+      }
+      sweep[families[f]][settings[f]].push_back(trials[f]);
+   }
+
+   map<string, vector<SettingSummary> > summaries;
+   for (auto& family : sweep) {
+      for (auto& setting : family.second) {
+	 summaries[family.first].push_back(summarizeSetting(family.first, setting.first, setting.second));
+      }
+   }
+
+   map<string, double> benchmarks;
+   for (auto& family : summaries) {
+      const string& name = family.first;
+      if (name.size() >= baselineSuffix.size() and name.compare(name.size() - baselineSuffix.size(), baselineSuffix.size(), baselineSuffix) == 0) {
+	 double best = -numeric_limits<double>::infinity();
+	 for (auto& setting : family.second) {
+	    best = max(best, setting.finalMean);
+	 }
+	 benchmarks[name] = best;
+      }
+   }
+
+   size_t padW = 15;
+   cerr << setw(padW) << "setting"
+	<< setw(padW) << "trials"
+	<< setw(padW) << "final"
+	<< setw(padW) << "finalCI95"
+	<< setw(padW) << "area"
+	<< setw(padW) << "effHoriz"
+	<< setw(padW) << "totalFPS" << endl;
+   for (auto& family : summaries) {
+      const string& name = family.first;
+
+      double benchmark = -numeric_limits<double>::infinity();
+      size_t bestPrefix = 0;
+      string dir = fs::path(name).parent_path().string();
+      for (auto& baseline : benchmarks) {
+	 if (fs::path(baseline.first).parent_path().string() != dir) {
+	    continue;
+	 }
+	 size_t prefix = mismatch(name.begin(), name.end(), baseline.first.begin(), baseline.first.end()).first - name.begin();
+	 if (prefix > bestPrefix) {
+	    bestPrefix = prefix;
+	    benchmark = baseline.second;
+	 }
+      }
+
+      cerr << name << " (benchmark " << benchmark << ")" << endl;
+      const SettingSummary* best = nullptr;
+      const SettingSummary* bestBad = nullptr;
+      for (auto& setting : family.second) {
+	 cerr << setw(padW) << setting.setting
+	      << setw(padW) << setting.numTrials
+	      << setw(padW) << setting.finalMean
+	      << setw(padW) << setting.finalCI
+	      << setw(padW) << setting.area
+	      << setw(padW) << setting.effHoriz
+	      << setw(padW) << setting.fps << endl;
+
+	 if (!bestBad or setting.finalMean > bestBad->finalMean) {
+	    bestBad = &setting;
+	 }
+	 if (setting.finalMean >= benchmark and (!best or setting.area > best->area)) {
+	    best = &setting;
+	 }
+      }
+
+      cout << (best ? best : bestBad)->glob << endl;
+   }
+
+   return 0;
+}
@@ -1,28 +1,77 @@
-#include "QLearner.hpp"
-#include "TileCodingQFunction.hpp"
-#include "Trajectory.hpp"
-#include "NNModel.hpp"
-#include "IncDTModel.hpp"
-#include "RLTypes.hpp"
-#include "MountainCar.hpp"
-#include "Acrobot.hpp"
-#include "GoRight.hpp"
-#include "dout.hpp"
+#include "Experiment.hpp"
+#include "Lockstep.hpp"
+#include "ForkServer.hpp"
+#include "WorkQueue.hpp"
+#include "Planner.hpp"
 #include "Params.hpp"
-#include "RNG.hpp"
+#include "Config.hpp"
+#include "Trace.hpp"
 
 #include <iostream>
-#include <ctime>
 #include <string>
+#include <vector>
 #include <fstream>
 #include <cxxopts.hpp>
-#include <chrono>
 #include <algorithm>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <numeric>
+#include <regex>
+#include <set>
+#include <filesystem>
+#include <chrono>
 #include <torch/torch.h>
 
 using namespace std;
 
-void parseParams(int argc, char* argv[], Params& params) {
+const vector<string> strNames({"game",
+				"planner",
+				"output",
+				"record_experience",
+				"replay_experience"});
+
+const vector<string> floatNames({"heartbeat",
+				  "measure_fraction",
+				  "gor_prize_mult",
+				  "split_confidence",
+				  "tie_threshold",
+				  "nn_step_size",
+				  "variance_smoothing",
+				  "step_size",
+				  "exploration_rate",
+				  "discount",
+				  "temperature",
+				  "decay"});
+
+const vector<string> sizeNames({"gor_length",
+				 "gor_num_ind",
+				 "num_frames",
+				 "seed",
+				 "checkpoint_every",
+				 "measure_every",
+				 "update_every",
+				 "max_leaves",
+				 "hidden_size",
+				 "batch_size",
+				 "horizon",
+				 "num_samples",
+				 "rollout_threads",
+				 "eval_episodes"});
+
+const vector<string> boolNames({"binary_output",
+				 "perf_counters",
+				 "footprint",
+				 "latency_hist",
+				 "resume",
+				 "predict_change",
+				 "use_nn",
+				 "use_gaussian",
+				 "sparse_weights"});
+
+cxxopts::ParseResult parseOptions(int argc, char* argv[]) {
    // Consider switching to CLI11?
    cxxopts::Options options("planning", "Run experiments with selective MVE planning.");
    options.add_options()
@@ -32,7 +81,31 @@ void parseParams(int argc, char* argv[], Params& params) {
       ("game", "Game Environment Used", cxxopts::value<string>()->default_value("GR"))
       ("o,output", "Output filename", cxxopts::value<std::string>()->default_value("test"))
       ("gen_config", "Generate a config file for this run", cxxopts::value<bool>()->default_value("false"))
+      ("binary_output", "Also write the results in binary columnar form to <output>.result.bin", cxxopts::value<bool>()->default_value("false"))
+      ("perf_counters", "Add columns with the cycles, instructions, L1 data and last-level cache misses, and branch misses per learning frame, counted during planning and model updates", cxxopts::value<bool>()->default_value("false"))
+      ("footprint", "Add columns with the node counts and approximate bytes of the Q-function, decision trees, stored trajectories, and NN training examples", cxxopts::value<bool>()->default_value("false"))
+      ("latency_hist", "Add columns with the median, 90th and 99th percentile, and maximum time (in microseconds) of each learning frame's action, planning, and model training, and of model updates; also write whole-run histograms to <output>.hist", cxxopts::value<bool>()->default_value("false"))
+      ("measure_every", "Measure the model's prediction errors and the uncertainty errors, which takes extra rollouts in the true environment and the oracle, on only every this many learning frames; the error columns average over the frames measured (0 to never measure them)", cxxopts::value<size_t>()->default_value("1"))
+      ("measure_fraction", "Measure the errors on only this fraction of the learning frames (of those measure_every allows), picked by a hash of the seed and frame number", cxxopts::value<double>()->default_value("1"))
+      ("checkpoint_every", "Save the run's state to <output>.ckpt about every this many frames, and when it finishes (0 to disable)", cxxopts::value<size_t>()->default_value("0"))
+      ("resume", "Continue from <output>.ckpt if it exists (finished runs are left as they are)", cxxopts::value<bool>()->default_value("false"))
+      ("rerun", "Run even if the output already holds a finished run with the same settings and build", cxxopts::value<bool>()->default_value("false"))
+      ("heartbeat", "Every this many seconds, atomically rewrite <output>.heartbeat with the run's progress, speed, memory use, and model size (0 to disable)", cxxopts::value<double>()->default_value("0"))
+      ("record_experience", "Write the start states, actions, rewards, result states, and terminations of the learning episodes to this binary file", cxxopts::value<string>()->default_value(""))
+      ("replay_experience", "Take the learning episodes' experience from this file (written by record_experience with the same seed and an exploration rate of 1) instead of the environment", cxxopts::value<string>()->default_value(""))
       ("c, config", "Filename of config file to use for settings", cxxopts::value<string>())
+      ("trace", "Write the time spent in each update, rollout, model update, and environment step to this file as Chrome trace JSON (needs a build configured with -DTRACING=ON)", cxxopts::value<string>())
+      ("trace_events", "Number of most recent timed scopes each thread keeps for --trace", cxxopts::value<size_t>()->default_value("1000000"))
+
+      // Sweeps
+      ("manifest", "File listing one config file per line; runs them all in this process", cxxopts::value<string>())
+      ("j,jobs", "Number of manifest runs to execute at once (0 for one per core)", cxxopts::value<size_t>()->default_value("0"))
+      ("halving", "Successive halving: at each budget keep only the best 1/this many settings of every sweep family (0 to disable)", cxxopts::value<size_t>()->default_value("0"))
+      ("halving_start", "Fraction of num_frames in the first successive-halving budget", cxxopts::value<double>()->default_value("0.1"))
+      ("queue", "Share the manifest's runs with every other worker using this directory (e.g. on a shared filesystem)", cxxopts::value<string>())
+      ("lease_timeout", "Seconds without a heartbeat after which another worker's queue lease is taken over", cxxopts::value<double>()->default_value("300"))
+      ("serve", "Run as a fork server: read config filenames, one per line, from this FIFO or unix socket and run each in a child process", cxxopts::value<string>())
+      ("lockstep", "Drive up to this many manifest runs with matching seed, environment, and model settings from one experience stream (0 to disable)", cxxopts::value<size_t>()->default_value("0"))
 
       // Go Right
       ("gor_length", "Length of GoRight hallway", cxxopts::value<size_t>()->default_value("10"))
@@ -49,6 +122,8 @@ void parseParams(int argc, char* argv[], Params& params) {
       ("m,temperature", "Temperature", cxxopts::value<double>()->default_value("1e-1"))
       ("y,decay", "Decay Factor", cxxopts::value<double>()->default_value("1"))
       ("k,num_samples", "Number of MC Samples", cxxopts::value<size_t>()->default_value("10"))
+      ("rollout_threads", "Number of threads (including the run's own) that share the MC samples of each rollout; the results do not depend on it", cxxopts::value<size_t>()->default_value("1"))
+      ("eval_episodes", "Evaluate each iteration with this many episodes on a snapshot of the Q-function, in parallel with learning; reports their mean and standard deviation (0 for one episode run in line)", cxxopts::value<size_t>()->default_value("0"))
 
       // Decision Tree
       ("update_every", "Split every", cxxopts::value<size_t>()->default_value("100"))
@@ -65,75 +140,48 @@ void parseParams(int argc, char* argv[], Params& params) {
       ("use_gaussian", "Use heteroschedastic Gaussian instead of IQN for sampling", cxxopts::value<bool>()->default_value("false"))
       ("variance_smoothing", "Smoothing value for heteroschedastic variance", cxxopts::value<double>()->default_value("1e-6"));
       
-   auto result = options.parse(argc, argv);
-
-   vector<string> strNames({"game",
-	                    "planner",
-                   	    "output"});
-
-   vector<string> floatNames({"gor_prize_mult",
-	                      "split_confidence",
-			      "tie_threshold",
-                   	      "nn_step_size",
-			      "variance_smoothing",
-			      "step_size",
-			      "exploration_rate",
-			      "discount",
-			      "temperature",
-			      "decay"});
-
-   vector<string> sizeNames({"gor_length",
-	                    "gor_num_ind",
-			    "num_frames",
-			    "seed",
-			    "update_every",
-			    "max_leaves",
-			    "hidden_size",
-			    "batch_size",
-			    "horizon",
-			    "num_samples"});
-
-   vector<string> boolNames({"predict_change",
-			     "use_nn",
-			     "use_gaussian",
-			     "sparse_weights"});	    
-   
-   if (result.count("config")) {
-      ifstream configIn(result["config"].as<string>());
-
-      if (configIn.is_open()) {
-	 string name;
-	 string dummy;
-	 // TODO: Falls apart with unrecognized variable name
-	 while (configIn >> name) {	   
-	    configIn >> dummy; // Consume the =
-	    if (find(strNames.begin(), strNames.end(), name) != strNames.end()) {
-	       string val;
-	       configIn >> val;
-	       params.setStr(name, val);	   
-	    } else if (find(floatNames.begin(), floatNames.end(), name) != floatNames.end()) {
-	       double val;
-	       configIn >> val;
-	       params.setFloat(name, val);
-	    } else if (find(sizeNames.begin(), sizeNames.end(), name) != sizeNames.end()) {
-	       size_t val;
-	       configIn >> val;
-	       params.setInt(name, val);
-	    } else if (find(boolNames.begin(), boolNames.end(), name) != boolNames.end()) {
-	       bool val;
-	       configIn >> val;
-	       params.setInt(name, val);
-	    } else {
-	       cerr << "Warning: ignoring unrecognized config file option: " << name << endl;
-	       cerr << "in given config file: " << result["config"].as<string>() << endl;
-	    }
+   return options.parse(argc, argv);
+}
+
+void readConfigFile(const string& filename, Params& params) {
+   ifstream configIn(filename);
+
+   if (configIn.is_open()) {
+      string name;
+      string dummy;
+      while (configIn >> name) {	   
+	 configIn >> dummy; // Consume the =
+	 if (find(strNames.begin(), strNames.end(), name) != strNames.end()) {
+	    string val;
+	    configIn >> val;
+	    params.setStr(name, val);	   
+	 } else if (find(floatNames.begin(), floatNames.end(), name) != floatNames.end()) {
+	    double val;
+	    configIn >> val;
+	    params.setFloat(name, val);
+	 } else if (find(sizeNames.begin(), sizeNames.end(), name) != sizeNames.end()) {
+	    size_t val;
+	    configIn >> val;
+	    params.setInt(name, val);
+	 } else if (find(boolNames.begin(), boolNames.end(), name) != boolNames.end()) {
+	    bool val;
+	    configIn >> val;
+	    params.setInt(name, val);
+	 } else {
+	    cerr << "Unrecognized config file option: " << name << endl;
+	    cerr << "in given config file: " << filename << endl;
+	    exit(1);
 	 }
-      } else {
-	 cerr << "Could not open config file for reading: " << result["config"].as<string>() << endl;
-	 exit(1);
       }
+   } else {
+      cerr << "Could not open config file for reading: " << filename << endl;
+      exit(1);
    }
+}
 
+// Fills in whatever the config file (if any) left unset and applies the
+// planner-specific overrides
+void resolveParams(const cxxopts::ParseResult& result, Params& params) {
    // If config file is given, explicitly provided parameters override
    for (auto name : strNames) {
       if (result.count(name) or !params.isSet(name)) {
@@ -157,72 +205,7 @@ void parseParams(int argc, char* argv[], Params& params) {
    }
 
    // Planner choice overrides some parameter values, even if explicitly provided
-   string planner = params.getStr("planner");
-
-   if (planner == "S" or
-       planner == "IS" or
-       planner == "E" or
-       planner == "IE" or
-       planner == "A" or
-       planner == "P" or
-       planner == "Q") {
-      params.setInt("num_samples", 1);
-      params.setFloat("temperature", numeric_limits<double>::infinity());
-   }
-
-   if (planner == "RR" or
-       planner == "IRR" or
-       planner == "RV" or
-       planner == "IRV") {
-      params.setInt("inc_rwd", 1);
-      params.setInt("inc_state", 0);
-   } else if (planner == "SRR" or
-	      planner == "ISRR" or
-	      planner == "SRV" or
-	      planner == "ISRV") {
-      params.setInt("inc_rwd", 1);
-      params.setInt("inc_state", 1);
-   } else { // SR, SV, ISR, ISV, and others that don't matter
-      params.setInt("inc_rwd", 0);
-      params.setInt("inc_state", 1);
-   }
-
-   if (planner == "MCTV" or
-       planner == "IMCTV" or
-       planner == "RV" or
-       planner == "IRV" or
-       planner == "SRV" or
-       planner == "ISRV") {
-      params.setInt("use_variance", 1);
-   } else {
-      params.setInt("use_variance", 0);
-   }
-
-   if (planner == "ITDR" or
-       planner == "TDR" or
-       planner == "IMCTDR" or
-       planner == "MCTDR" or
-       planner == "IDTOR" or
-       planner == "DTOR" or
-       planner == "IMCTDOR" or
-       planner == "MCTDOR") {
-      params.setInt("directional_range", 1);
-   } else {
-      params.setInt("directional_range", 0);
-   }
-   
-   if (planner == "ITOR" or
-       planner == "TOR" or
-       planner == "IMCTOR" or
-       planner == "MCTOR" or
-       planner == "ITDOR" or
-       planner == "TDOR" or
-       planner == "IMCTDOR" or
-       planner == "MCTDOR") {
-      params.setInt("reject_overlap", 1);
-   } else {
-      params.setInt("reject_overlap", 0);
-   }
+   Planner::get(params.getStr("planner")).applyOptions(params);
 
    // Generate a config file if requested
    if (result["gen_config"].as<bool>()) {
@@ -230,7 +213,10 @@ void parseParams(int argc, char* argv[], Params& params) {
       ofstream configOut(configFilename);
       if (configOut.is_open()) {
 	 for (auto name : strNames) {
-	    configOut << name << " = " << params.getStr(name) << endl;
+	    // An empty value could not be read back; left out, it gets the same default
+	    if (!params.getStr(name).empty()) {
+	       configOut << name << " = " << params.getStr(name) << endl;
+	    }
 	 }
 	 for (auto name : floatNames) {
 	    configOut << name << " = " << params.getFloat(name) << endl;
@@ -249,657 +235,340 @@ void parseParams(int argc, char* argv[], Params& params) {
    }
 }
 
-int main(int argc, char* argv[]) {
-   Params params;
-   parseParams(argc, argv, params);
-
-   enum PlanningAlg {qlearning, unselective, state, target, monteCarlo};
-
-   string planner = params.getStr("planner");
-   PlanningAlg alg;
-   NNModel::TrainingType trainType;
-   if (planner == "Q") {
-      alg = qlearning;
-   } else if (planner == "P" or
-	      planner == "A" or
-	      planner == "IE" or
-	      planner == "E") {
-      alg = unselective;
-      trainType = NNModel::mse;
-   } else if (planner == "ISV" or
-	      planner == "SV" or
-	      planner == "IRV" or
-	      planner == "RV" or
-	      planner == "ISRV" or
-	      planner == "SRV") {
-      alg = state;
-      trainType = NNModel::gaussian;
-   } else if (planner == "ISR" or
-	      planner == "SR" or
-	      planner == "IRR" or
-	      planner == "RR" or
-	      planner == "ISRR" or
-	      planner == "SRR") {
-      alg = state;
-      trainType = NNModel::bound;
-   } else if (planner == "ITR" or
-	      planner == "TR" or
-	      planner == "ITDR" or
-	      planner == "TDR" or
-	      planner == "ITOR" or
-	      planner == "TOR" or
-	      planner == "ITDOR" or
-	      planner == "TDOR") {
-      alg = target;
-      trainType = NNModel::bound;
-   } else if (planner == "IS" or
-	      planner == "S" or
-	      planner == "IMCTV" or
-	      planner == "MCTV" or
-	      planner == "IMCTR" or
-	      planner == "MCTR" or
-	      planner == "IMCTDR" or
-	      planner == "MCTDR" or
-	      planner == "IMCTOR" or
-	      planner == "MCTOR" or
-	      planner == "IMCTDOR" or
-	      planner == "MCTDOR") {
-      alg = monteCarlo;
-      if (params.getInt("use_gaussian")) {
-	 trainType = NNModel::gaussian;
-      } else {
-	 trainType = NNModel::iqn;
+// Calls task(0), ..., task(numTasks - 1) from up to numThreads threads
+void runParallel(size_t numTasks, size_t numThreads, const function<void(size_t)>& task) {
+   numThreads = min(numThreads, numTasks);
+
+   // The runs themselves supply the parallelism
+   if (numThreads > 1) {
+      torch::set_num_threads(1);
+   }
+
+   atomic<size_t> nextTask(0);
+   auto worker = [&]() {
+      size_t t;
+      while ((t = nextTask++) < numTasks) {
+	 task(t);
       }
-   } else {
-      cerr << "Planner " << planner << " not recognized.";
-      exit(1);
+   };
+
+   vector<thread> workers;
+   for (size_t w = 0; w < numThreads; ++w) {
+      workers.emplace_back(worker);
    }
-   
-   streambuf* coutbuf = cout.rdbuf();
-   ofstream outFile(params.getStr("output") + ".result");
-   if (!outFile.is_open()) {
-      cerr << "Failed to open the output file: " << params.getStr("output") + ".result" << endl;
-      exit(1);
+   for (auto& w : workers) {
+      w.join();
    }
-   cout.rdbuf(outFile.rdbuf());
-
-
-   RNG initRNG(params.getInt("seed"));
-   RNG rng(initRNG.randomInt());
-   torch::manual_seed(initRNG.randomInt());
-
-   PredictionModel* env;
-   BBIPredictionModel* uncertainEnv = nullptr;   
-   QFunction* qFunc;
-   size_t stateDim;
-   act_t numActions;
-
-   vector<Bound> dimRanges;
-   string game = params.getStr("game");
-   if(game == "MC") {
-      env = new MountainCar();
-      stateDim = 2;
-      numActions = 3;
-      dimRanges = {{-1.2, 0.6}, {-0.07, 0.07}};
-      qFunc = new TileCodingQFunction(dimRanges, // feature ranges
-				      {8, 8}, // numDivisions
-				      8, // num tilings
-				      numActions,
-				      initRNG);
-   } else if(game == "A") {
-      env = new Acrobot(false, initRNG);
-      stateDim = 4;
-      numActions = 3;
-      dimRanges = {{-M_PI, M_PI}, {-M_PI, M_PI}, {-4*M_PI, 4*M_PI}, {-9*M_PI, 9*M_PI}};
-      vector<size_t> numDivisions({6, 7, 6, 7});
-
-      vector<QFunction*> qFuncs;      
-      // all 4 dimensions
-      qFuncs.push_back(new TileCodingQFunction(dimRanges, numDivisions, 12, numActions, rng));
-      // choose 3 dimensions / exclude 1 dimension
-      for (size_t i = 0; i < stateDim; ++i) {
-         vector<size_t> curNumDivisions = numDivisions;
-         curNumDivisions[i] = 1;
-         qFuncs.push_back(new TileCodingQFunction(dimRanges, curNumDivisions, 3, numActions, rng));
-      }      
-      // choose 2 dimensions / exclude 2 dimension
-      for (size_t i = 0; i < stateDim; ++i) {
-         for (size_t j = i+1; j < stateDim; ++j) {
-            vector<size_t> curNumDivisions = numDivisions;
-            curNumDivisions[i] = 1;
-            curNumDivisions[j] = 1;
-            qFuncs.push_back(new TileCodingQFunction(dimRanges, curNumDivisions, 2, numActions, rng));
-	 } 
-      }      
-      // choose 1 dimension 
-      for (size_t i = 0; i < stateDim; ++i) {
-         vector<size_t> curNumDivisions(stateDim, 1);
-         curNumDivisions[i] = numDivisions[i];
-         qFuncs.push_back(new TileCodingQFunction(dimRanges, curNumDivisions, 3, numActions, rng));
-      }      
-      qFunc = new SumQ(qFuncs, numActions);
-   } else if (game == "AD") {
-      env = new Acrobot(true, initRNG);
-      stateDim = 5;
-      numActions = 3;
-      dimRanges = {{-M_PI, M_PI}, {-M_PI, M_PI}, {-4*M_PI, 4*M_PI}, {-9*M_PI, 9*M_PI}, {-9*M_PI, 9*M_PI}};
-      vector<size_t> numDivisions({6, 7, 6, 7, 7});
-
-      vector<QFunction*> qFuncs;         
-      // all 5 dimensions
-      qFuncs.push_back(new TileCodingQFunction(dimRanges, numDivisions, 20, numActions, rng));
-      // choose 4 dimensions / exclude 1 dimension
-      for (size_t i = 0; i < stateDim; ++i) {
-         vector<size_t> curNumDivisions = numDivisions;
-         curNumDivisions[i] = 1;
-         qFuncs.push_back(new TileCodingQFunction(dimRanges, curNumDivisions, 4, numActions, rng));
-      }      
-      // choose 3 dimensions / exclude 2 dimension
-      for (size_t i = 0; i < stateDim; ++i) {
-         for (size_t j = i+1; j < stateDim; ++j) {
-            vector<size_t> curNumDivisions = numDivisions;
-            curNumDivisions[i] = 1;
-            curNumDivisions[j] = 1;
-            qFuncs.push_back(new TileCodingQFunction(dimRanges, curNumDivisions, 2, numActions, rng));
-	 } 
-      }      
-      // choose 2 dimensions / exclude 3 dimension
-      for (size_t i = 0; i < stateDim; ++i) {
-         for (size_t j = i+1; j < stateDim; ++j) {
-            vector<size_t> curNumDivisions(stateDim, 1);
-            curNumDivisions[i] = numDivisions[i];
-            curNumDivisions[j] = numDivisions[j];
-            qFuncs.push_back(new TileCodingQFunction(dimRanges, curNumDivisions, 2, numActions, rng));
-	 } 
-      }      
-      // choose 1 dimension / exclude 4 dimension
-      for (size_t i = 0; i < stateDim; ++i) {
-         vector<size_t> curNumDivisions(stateDim, 1);
-         curNumDivisions[i] = numDivisions[i];
-         qFuncs.push_back(new TileCodingQFunction(dimRanges, curNumDivisions, 4, numActions, rng));
-      }      
-      qFunc = new SumQ(qFuncs, numActions);
-   } else {// game == GR
-      size_t length = params.getInt("gor_length");
-      size_t numInd = params.getInt("gor_num_ind");
-      env = new GoRight(params);
-      uncertainEnv = new GoRightUncertain(initRNG, params);
-
-      if (params.getStr("planner") == "A") {
-	 stateDim = 3 + numInd;
-      } else {
-	 stateDim = 2 + numInd;
-      }
-      numActions = 2;
-      
-      dimRanges.push_back({rlfloat_t(-0.5), rlfloat_t(length + 0.5)});
-      for (size_t i = 0; i < numInd; ++i) {
-	 dimRanges.push_back({rlfloat_t(-0.25), rlfloat_t(1.25)});
-      }
-      size_t maxStat = 2;
-      rlfloat_t statScale = length/maxStat;
-      dimRanges.push_back({rlfloat_t(-0.5*statScale), rlfloat_t(statScale*(maxStat + 0.5))});
-
-      vector<size_t> numDiv;
-      numDiv.push_back(length + 1);
-      for (size_t i = 0; i < numInd; ++i) {
-	 numDiv.push_back(2);
-      }
-      numDiv.push_back(maxStat + 1);
-      
-      qFunc = new TileCodingQFunction(dimRanges,
-					numDiv,
-					1,
-					numActions,
-					initRNG);
-
-      // Tile coding ignores the last dim no matter what
-      // But the model might use it
-      if (stateDim == 3 + numInd) {
-	 dimRanges.push_back({rlfloat_t(-0.5*statScale), rlfloat_t(statScale*(maxStat + 0.5))});
+}
+
+// Moves a run's partial results aside so they are not mistaken for a
+// finished run by aggregate or the analysis scripts
+void stopRun(const Config& config) {
+   for (string ext : {".result", ".result.bin"}) {
+      string filename = config.output + ext;
+      if (filesystem::exists(filename)) {
+	 filesystem::rename(filename, filename + ".stopped");
       }
    }
+   // It refers to results that are no longer there
+   filesystem::remove(config.output + ".ckpt");
+}
 
-   uniform_int_distribution<act_t> actDist(0, numActions-1);
-
-   QLearner* agent = new QLearner(qFunc,
-				  numActions,
-				  initRNG,
-				  params);
-   
-   LearnedModel* model;
-   if (params.getInt("use_nn")) {
-      model = new NNModel(stateDim,    // inDim
-			  stateDim,    // targetDim
-			  numActions,
-			  dimRanges,
-			  initRNG,
-			  trainType,
-			  params);
-   } else {
-      model = new IncDTModel(stateDim,
-			     numActions,
-			     initRNG,
-			     params);
-   }
-   
-   BBIPredictionModel* planningModel;
-   if (planner[0] == 'I') {
-      planningModel = uncertainEnv;
-   } else {
-      planningModel = dynamic_cast<BBIPredictionModel*>(model);
+// Successive halving. Every run is taken to a first budget, then within each
+// sweep family only the best 1/halving of the settings (by mean evalReturn
+// over their trials) go on to a budget halving times larger, and so on up to
+// num_frames. Runs stay in memory between budgets, so the survivors write
+// exactly what uninterrupted runs would.
+void runHalving(const cxxopts::ParseResult& result, const vector<string>& configNames, const vector<Config>& configs, size_t numThreads) {
+   size_t eta = result["halving"].as<size_t>();
+   double fraction = result["halving_start"].as<double>();
+   if (fraction <= 0 or fraction > 1) {
+      cerr << "--halving_start must be greater than 0 and at most 1." << endl;
+      exit(1);
    }
-		  
-   bool modelUpdated = false;
-      
-   vector<Trajectory*> data;   
-   rlfloat_t epReward = 0;
-   rlfloat_t epReturn = 0;
-   rlfloat_t totalDiscount = 0;
-
-   double totalTime = 0;
-   double totalPlanTime = 0;
-   size_t totalFrames = 0;
-   size_t framesSinceSplit = 0;
-//   size_t ep = 0;
-
-   size_t horizon = params.getInt("horizon");
-
-   size_t padW = 15;
-   size_t col = 1;
-   cout << setw(padW) << to_string(col) + "_totFrames";
-   ++col;
-   cout << setw(padW) << to_string(col) + "_epFPS";
-   ++col;
-   cout << setw(padW) << to_string(col) + "_totalFPS";
-   ++col;
-   cout << setw(padW) << to_string(col) + "_epPlanFPS";
-   ++col;
-   cout << setw(padW) << to_string(col) + "_totalPlanFPS";
-   ++col;
-   cout << setw(padW) << to_string(col) + "_epScore";
-   ++col;
-   cout << setw(padW) << to_string(col) + "_epReturn";
-   ++col;
-   cout << setw(padW) << to_string(col) + "_epFrames";
-   ++col;
-   cout << setw(padW) << to_string(col) + "_evalScore";
-   ++col;
-   cout << setw(padW) << to_string(col) + "_evalReturn";
-   ++col;
-   cout << setw(padW) << to_string(col) + "_evalFrames";
-   ++col;
-   cout << setw(padW) << to_string(col) + "_effHoriz";
-   ++col;
-   
-   string errNames[] {"StateErr", "RwdErr", "TermErr", "PredErr", "TargErr", "UncErr", "NumInf", "Num-Inf", "uErrMin", "uErrLQ", "uErrMed", "uErrUQ", "uErrMax", "utCorr"};
-   for (auto name : errNames) {
-      for (size_t h = 2; h <= horizon; ++h) {
-	 cout << setw(padW) << to_string(col) + "_" + name + "_h" + to_string(h);
-	 ++col;
+
+   // Same naming as aggregate: <family>.a<step size>[.m<temperature>].t<trial>
+   // A run with some other name is a family of its own and is never stopped
+   const regex runName("(.*)\\.(a[^./]+(\\.m[^./]+)?)\\.t[0-9]+");
+   vector<string> families(configs.size());
+   vector<string> settings(configs.size());
+   for (size_t i = 0; i < configs.size(); ++i) {
+      smatch match;
+      if (regex_match(configs[i].output, match, runName)) {
+	 families[i] = match[1];
+	 settings[i] = match[2];
+      } else {
+	 families[i] = configs[i].output;
       }
-      cout << setw(padW) << to_string(col) + "_" + name;
-      ++col;
    }
-   
-   cout << endl;
-   
-   while (totalFrames < size_t(params.getInt("num_frames"))) {
-      vector<double> uncSum(horizon-1, 0);
-      vector<double> tgtSum(horizon-1, 0);
-      vector<double> uncXtgt(horizon-1, 0);
-      vector<double> uncXunc(horizon-1, 0);
-      vector<double> tgtXtgt(horizon-1, 0);
-      vector<size_t> nonInf(horizon-1, 0);
-
-      vector<rlfloat_t> stateError(horizon-1, 0);
-      vector<rlfloat_t> rwdError(horizon-1, 0);
-      vector<rlfloat_t> termError(horizon-1, 0);
-      vector<rlfloat_t> predError(horizon-1, 0);
-      vector<rlfloat_t> targetError(horizon-1, 0);
-      vector<vector<rlfloat_t> > uncertaintyErrors(horizon-1);
-      vector<rlfloat_t> uncertaintyError(horizon-1, 0);
-      vector<size_t> numInf(horizon-1, 0);
-      vector<size_t> numNegInf(horizon-1, 0);
-
-      size_t learnFrames = 0;
-
-      vector<vector<rlfloat_t>*> errs({&stateError, &rwdError, &termError, &predError});
-      vector<vector<size_t>*> infCounts({&numInf, &numNegInf});
-      
-      
-      double effectiveHorizon = 0;
-      
-      for (unsigned char eval = 0; eval < 2; ++eval) {
-	 size_t numFrames = 0;
-	 epReward = 0;
-	 epReturn = 0;
-	 totalDiscount = 1;
-
-	 State curState;
-	 if (game == "MC") {
-	    curState = {0,0};
-	 } else if (game == "A") {
-	    curState = {0,0,0,0};
-	 } else if (game == "AD") {
-	    curState = {0,0,0,0,0};
-	 } else if (game == "GR") {
-	    curState.push_back(rng.randomFloat()*0.5 - 0.25);
-
-	    size_t length = params.getInt("gor_length");
-	    size_t numInd = params.getInt("gor_num_ind");
-	    for (size_t i = 0; i < numInd; ++i) {
-	       curState.push_back(0);
-	    }
 
-	    size_t numStat = 3;	    
-	    rlfloat_t statScale = double(length)/(numStat - 1);
-	    rlfloat_t prevStat = int(rng.randomFloat()*numStat)*statScale;
-	    rlfloat_t initStat = int(rng.randomFloat()*numStat)*statScale;
-	    rlfloat_t statOffset = rng.randomFloat()*statScale/2 - statScale/4;
-	    curState.push_back(statOffset + initStat);
-	    curState.push_back(statOffset + prevStat);
+   vector<Experiment*> runs(configs.size(), nullptr);
+   vector<size_t> alive(configs.size());
+   iota(alive.begin(), alive.end(), 0);
+
+   for (; fraction < 1; fraction *= eta) {
+      runParallel(alive.size(), numThreads, [&](size_t a) {
+	 size_t i = alive[a];
+	 if (!runs[i]) {
+	    runs[i] = new Experiment(configs[i]);
 	 }
-	 
-	 bool terminated = false;
+	 runs[i]->runUntil(fraction*configs[i].numFrames);
+      });
+
+      // family -> setting -> (total score, number of trials)
+      map<string, map<string, pair<double, size_t> > > scores;
+      for (auto i : alive) {
+	 auto& score = scores[families[i]][settings[i]];
+	 score.first += runs[i]->getMeanEvalReturn();
+	 ++score.second;
+      }
 
-	 if (!eval) {
-	    data.push_back(new Trajectory(curState, terminated));
+      set<pair<string, string> > kept;
+      for (auto& family : scores) {
+	 vector<pair<double, string> > ranked;
+	 for (auto& setting : family.second) {
+	    ranked.push_back({setting.second.first/setting.second.second, setting.first});
+	 }
+	 sort(ranked.rbegin(), ranked.rend());
+	 size_t numKept = (ranked.size() + eta - 1)/eta;
+	 for (size_t r = 0; r < numKept; ++r) {
+	    kept.insert({family.first, ranked[r].second});
 	 }
+      }
 
-	 auto epStart = chrono::high_resolution_clock::now();
-	 double epPlanTime = 0;
-	 
-	 for (size_t t = 0; t < 500 and !terminated; ++t) {
-	    act_t action;
-	    Trajectory& curTraj = *data.back();
-
-            if (!eval) {
-	       if (rng.randomFloat() < params.getFloat("exploration_rate")) {
-		  action = rng.randomFloat()*numActions;
-	       } else {
-		  DOUT << "greedy (learned Q-function)" << endl;
-		  action = agent->getGreedyAction(curState);
-	       }
-	    } else {
-	       action = agent->getGreedyAction(curState);
-	    }
+      vector<size_t> survivors;
+      for (auto i : alive) {
+	 if (kept.count({families[i], settings[i]})) {
+	    survivors.push_back(i);
+	 } else {
+	    delete runs[i];
+	    runs[i] = nullptr;
+	    stopRun(configs[i]);
+	    cerr << "Stopped: " << configNames[i] << endl;
+	 }
+      }
+      cerr << "Kept " << survivors.size() << " of " << alive.size() << " runs at " << fraction*100 << "% of num_frames" << endl;
+      alive = survivors;
+   }
 
-	    State resultState;
+   size_t numDone = 0;
+   mutex progressMutex;
+   runParallel(alive.size(), numThreads, [&](size_t a) {
+      size_t i = alive[a];
+      if (!runs[i]) {
+	 runs[i] = new Experiment(configs[i]);
+      }
+      runs[i]->run();
+      delete runs[i];
+      runs[i] = nullptr;
+
+      lock_guard<mutex> lock(progressMutex);
+      ++numDone;
+      cerr << "[" << numDone << "/" << alive.size() << "] " << configNames[i] << endl;
+   });
+}
 
-	    if (eval) {
-	       DOUT << "Eval ";
+// Each of numThreads threads repeatedly claims an unfinished run from the
+// queue directory and runs it, until every run is done by some worker
+void runQueue(const cxxopts::ParseResult& result, const vector<string>& configNames, const vector<Config>& configs, size_t numThreads) {
+   WorkQueue queue(result["queue"].as<string>(), result["lease_timeout"].as<double>());
+   // Time to wait before looking again when every unfinished run is leased out
+   auto retryInterval = chrono::duration<double>(min(max(queue.getLeaseTimeout()/10, 1.0), 30.0));
+
+   mutex progressMutex;
+   runParallel(numThreads, numThreads, [&](size_t) {
+      while (true) {
+	 bool anyLeft = false;
+	 bool ranOne = false;
+	 for (size_t i = 0; i < configs.size() and !ranOne; ++i) {
+	    if (queue.isDone(configNames[i])) {
+	       continue;
 	    }
-	    DOUT << "Frame: " << totalFrames << " Episode Step " << t << ": ";
-	    for (auto d : curState) {
-	       DOUT << d << " ";
+	    anyLeft = true;
+	    if (!queue.claim(configNames[i])) {
+	       continue;
 	    }
-	    DOUT << " action: " << action << endl;
-
-	    env->getStatePrediction(curState, action, resultState);
-         
-	    rlfloat_t r = env->getRewardPrediction(curState, action);
-	    epReward += r;
-	    epReturn += totalDiscount*r;
-	    totalDiscount *= params.getFloat("discount");
-
-	    terminated = env->getTermPrediction(curState, action) > 0.5;
-
-	    if (!eval) {
-	       curTraj.addStep(action, r, resultState, terminated);
-
-	       QLearner::Measurements measurements;
-
-	       auto planStart = chrono::high_resolution_clock::now();
-	       
-	       if (planner == "P") {
-		  agent->mveUpdate(curTraj, t, env, measurements);
-	       } else {
-		  if (alg == qlearning or
-		      (planningModel != uncertainEnv and !modelUpdated) or
-		      horizon == 1) {
-		     agent->qUpdate(curTraj, t);
-		  } else if (alg == unselective) {
-		     agent->mveUpdate(curTraj, t, planningModel, env, measurements);
-		  } else if (alg == target) {
-		     agent->targetRangeSMVEUpdate(curTraj, t, planningModel, env, uncertainEnv, measurements);
-		  } else if (alg == state) {
-		     agent->oneStepUncertaintySMVEUpdate(curTraj, t, planningModel, env, uncertainEnv, measurements);
-		  } else { // (alg == monteCarlo) {
-		     agent->monteCarloSMVEUpdate(curTraj, t, planningModel, env, uncertainEnv, measurements);
-		  } 
-		  
-		  model->addExample(curTraj, t);
-	       }
-
-	       auto planEnd = chrono::high_resolution_clock::now();
-	       auto planTime = chrono::duration_cast<chrono::duration<double>>(planEnd - planStart).count();
-	       epPlanTime += planTime;
-	       totalPlanTime += planTime;
-	       
-	       double totalWeight;
-	       if (measurements.weights.size() > 0) {
-		  totalWeight = measurements.weights[0];
-	       } else {
-		  totalWeight = 1;
-	       }
-	       double weightedHorizon = totalWeight;
-	       for (size_t h = 1; h < measurements.stateError.size(); ++h) {
-		  if (measurements.uncertainties[h] != numeric_limits<double>::infinity()) {
-		     uncSum[h-1] += measurements.uncertainties[h];
-		     tgtSum[h-1] += fabs(measurements.targetError[h]);
-		     uncXtgt[h-1] += measurements.uncertainties[h]*fabs(measurements.targetError[h]);
-		     uncXunc[h-1] += measurements.uncertainties[h]*measurements.uncertainties[h];
-		     tgtXtgt[h-1] += measurements.targetError[h]*fabs(measurements.targetError[h]);
-		     ++nonInf[h-1];
-		  }
-		  
-		  for (auto d : measurements.stateError[h]) {
-		     stateError[h-1] += (d*d)/stateDim;
-		     predError[h-1] += (d*d)/(stateDim+2);
-		  }
-		  rlfloat_t sqRErr = measurements.rwdError[h]*measurements.rwdError[h];
-		  rwdError[h-1] += sqRErr;
-		  predError[h-1] += sqRErr/(stateDim+2);
-		  rlfloat_t sqTErr = measurements.termError[h]*measurements.termError[h];
-		  termError[h-1] += sqTErr;
-		  predError[h-1] += sqTErr/(stateDim+2);
-		  targetError[h-1] += fabs(measurements.targetError[h]);
-		  if (uncertainEnv) { // If we have an oracle
-		     uncertaintyErrors[h-1].push_back(measurements.uncertaintyError[h]);
-		     if (measurements.uncertaintyError[h] == numeric_limits<double>::infinity()) {
-			++numInf[h-1];
-		     } else if (measurements.uncertaintyError[h] == -numeric_limits<double>::infinity()) {
-			++numNegInf[h-1];
-		     } else {
-			uncertaintyError[h-1] += fabs(measurements.uncertaintyError[h]);
-		     }
-		  } else {
-		     DOUT << "Pushing back 0" << endl;
-		     uncertaintyErrors[h-1].push_back(0);
-		  }
-		  totalWeight += measurements.weights[h];
-		  weightedHorizon += measurements.weights[h]*(h+1);
-	       }
-
-	       effectiveHorizon += weightedHorizon/totalWeight;
-	       DOUT << "Effective horizon: " << weightedHorizon/totalWeight << endl;
-	       
-	       ++totalFrames;
-	       ++framesSinceSplit;
-
-	       if (planner != "P" and
-		   planner != "Q" and
-		   planningModel != uncertainEnv and
-		   horizon > 1 and
-		   framesSinceSplit >= size_t(params.getInt("update_every"))) {
-		  DOUT << "Updating Model " << totalFrames << endl;
-		  model->updatePredictions();
-		  framesSinceSplit = 0;
-		  modelUpdated = true;
-	       }
-	    }
-	    curState = resultState;
-	    ++numFrames;
-	    if (!eval) {
-	       ++learnFrames;
+
+	    // A worker may have died after finishing the run but before marking it done
+	    if (result["rerun"].as<bool>() or !Experiment::isComplete(configs[i])) {
+	       Experiment experiment(configs[i]);
+	       experiment.run();
 	    }
+	    queue.complete(configNames[i]);
+	    ranOne = true;
+
+	    lock_guard<mutex> lock(progressMutex);
+	    cerr << "[done] " << configNames[i] << endl;
 	 }
 
-	 auto epEnd = chrono::high_resolution_clock::now();
-	 auto epTime = chrono::duration_cast<chrono::duration<double>>(epEnd - epStart).count();
-	 totalTime += epTime;
-	 
-	 if (!eval) {
-	    cout << setw(padW) << totalFrames;
-	    cout << setw(padW) << double(numFrames)/epTime;
-	    cout << setw(padW) << double(totalFrames)/totalTime;
-	    cout << setw(padW) << double(numFrames)/epPlanTime;
-	    cout << setw(padW) << double(totalFrames)/totalPlanTime;
+	 if (!anyLeft) {
+	    return;
 	 }
-	 cout << setw(padW) << epReward;
-	 cout << setw(padW) << epReturn;
-	 cout << setw(padW) << numFrames;
-	 
-	 if (eval) {
-	    cout << setw(padW) << effectiveHorizon/learnFrames;
-
-	    rlfloat_t total = 0;
-
-	    for (size_t e = 0; e < errs.size(); ++e) { // stateErr, rwdErr, termErr
-	       total = 0;
-	       for (size_t h = 0; h < horizon-1; ++h) {		  
-		  cout << setw(padW) << sqrt((*errs[e])[h]/learnFrames);
-		  total += (*errs[e])[h]/learnFrames;
-	       }
-	       if (horizon > 1) {
-		  cout << setw(padW) << sqrt(total/(horizon-1));
-	       } else {
-		  cout << setw(padW) << 0;
-	       }
-	    }
+	 if (!ranOne) {
+	    this_thread::sleep_for(retryInterval);
+	 }
+      }
+   });
+}
 
-	    total = 0;
-	    for (size_t h = 0; h < horizon-1; ++h) {
-	       cout << setw(padW) << targetError[h]/learnFrames;
-	       total += targetError[h]/learnFrames;
-	    }
-	    if (horizon > 1) {
-	       cout << setw(padW) << sqrt(total/(horizon-1));
-	    } else {
-	       cout << setw(padW) << 0;
-	    }
+void runManifest(const cxxopts::ParseResult& result) {
+   string manifestName = result["manifest"].as<string>();
+   ifstream manifestIn(manifestName);
+   if (!manifestIn.is_open()) {
+      cerr << "Could not open manifest file for reading: " << manifestName << endl;
+      exit(1);
+   }
 
-	    total = 0;
-	    for (size_t h = 0; h < horizon-1; ++h) {
-	       cout << setw(padW) << uncertaintyError[h]/(learnFrames - numInf[h] - numNegInf[h]);
-	       total += uncertaintyError[h]/(learnFrames - numInf[h] - numNegInf[h]);
-	    }
-	    if (horizon > 1) {
-	       cout << setw(padW) << sqrt(total/(horizon-1));
-	    } else {
-	       cout << setw(padW) << 0;
-	    }
-	    
-	    for (size_t c = 0; c < infCounts.size(); ++c) {
-	       total = 0;
-	       for (size_t h = 0; h < horizon-1; ++h) {
-		  cout << setw(padW) << (*infCounts[c])[h];
-		  total += (*infCounts[c])[h];
-	       }
-	       cout << setw(padW) << total;
-	    }
+   // Parse every config up front so a bad entry fails before any run starts
+   vector<string> configNames;
+   vector<Config> configs;
+   string line;
+   while (getline(manifestIn, line)) {
+      line.erase(0, line.find_first_not_of(" \t\r"));
+      line.erase(line.find_last_not_of(" \t\r") + 1);
+      if (line.empty() or line[0] == '#') {
+	 continue;
+      }
+      Params params;
+      readConfigFile(line, params);
+      resolveParams(result, params);
+      Config config(params);
+      if (!result["rerun"].as<bool>() and Experiment::isComplete(config)) {
+	 cerr << "Already complete: " << line << endl;
+	 continue;
+      }
+      configNames.push_back(line);
+      configs.push_back(config);
+   }
 
-	    vector<rlfloat_t> quantiles({0, 0.25, 0.5, 0.75, 1});
-	    for (auto q : quantiles) {
-	       vector<rlfloat_t> allErrs;
-	       for (size_t h = 0; h < horizon-1; ++h) {
-		  if (uncertaintyErrors[h].size() > 0) {
-		     sort(uncertaintyErrors[h].begin(), uncertaintyErrors[h].end());
-		     size_t idx = (uncertaintyErrors[h].size()-1)*q;		  
-		     cout << setw(padW) << uncertaintyErrors[h][idx];
-		     allErrs.insert(allErrs.end(), uncertaintyErrors[h].begin(), uncertaintyErrors[h].end());
-		  } else {
-		     cout << setw(padW) << 0;
-		  }
-	       }
-
-	       if (allErrs.size() > 0) { 
-		  sort(allErrs.begin(), allErrs.end());
-		  size_t idx = (allErrs.size()-1)*q;
-		  cout << setw(padW) << allErrs[idx];
-	       } else {
-		  cout << setw(padW) << 0;
-	       }
-	    }
-	    
-	    rlfloat_t totalUncSum = 0;
-	    rlfloat_t totalTgtSum = 0;
-	    rlfloat_t totalUncXTgt = 0;
-	    rlfloat_t totalUncXUnc = 0;
-	    rlfloat_t totalTgtXTgt = 0;
-	    size_t totalNonInf = 0;
-	    for (size_t h = 0; h < horizon-1; ++h) {
-	       rlfloat_t corrNum = nonInf[h]*uncXtgt[h] - uncSum[h]*tgtSum[h];
-	       rlfloat_t corrDenUnc = nonInf[h]*uncXunc[h] - uncSum[h]*uncSum[h];
-	       if (corrDenUnc < 0) { // Can only happen because of floating point error
-		  corrDenUnc = 0;
-	       }
-	       rlfloat_t corrDenTgt = nonInf[h]*tgtXtgt[h] - tgtSum[h]*tgtSum[h];
-	       if (corrDenTgt < 0) { // Can only happen because of floating point error
-		  corrDenTgt = 0;
-	       }
-	       rlfloat_t corrDen = sqrt(corrDenUnc) * sqrt(corrDenTgt);
-	       DOUT << "nonInf[h] " << nonInf[h] << " uncXunc[h] " << uncXunc[h] << " uncSum[h] " << uncSum[h] << " tgtXtgt[h] " << tgtXtgt[h] << " tgtSum[h] " << tgtSum[h] << endl;
-	       DOUT << "sqrt1: " << nonInf[h]*uncXunc[h] - uncSum[h]*uncSum[h] << " sqrt2: " << nonInf[h]*tgtXtgt[h] - tgtSum[h]*tgtSum[h] << endl;
-	       DOUT << "corrNum: " << corrNum << " corrDen: " << corrDen << " corr: " << corrNum/corrDen << endl;
-	       
-	       if (corrDen != 0) {
-		  cout << setw(padW) << corrNum/corrDen;
-	       } else {
-		  cout << setw(padW) << 0;
-	       }
-
-	       totalUncSum += uncSum[h];
-	       totalTgtSum += tgtSum[h];
-	       totalUncXTgt += uncXtgt[h];
-	       totalUncXUnc += uncXunc[h];
-	       totalTgtXTgt += tgtXtgt[h];
-	       totalNonInf += nonInf[h];
-	    }
-	    rlfloat_t corrNum = totalNonInf*totalUncXTgt - totalUncSum*totalTgtSum;
-	    rlfloat_t corrDenUnc = totalNonInf*totalUncXUnc - totalUncSum*totalUncSum;
-	    if (corrDenUnc < 0) { // Can only happen because of floating point error
-	       corrDenUnc = 0;
-	    }
-	    rlfloat_t corrDenTgt = totalNonInf*totalTgtXTgt - totalTgtSum*totalTgtSum;
-	    if (corrDenTgt < 0) { // Can only happen because of floating point error
-	       corrDenTgt = 0;
-	    }
-	    rlfloat_t corrDen = sqrt(corrDenUnc) * sqrt(corrDenTgt);
-
-	    DOUT << "nonInf " << totalNonInf << " uncXunc " << totalUncXUnc << " uncSum " << totalUncSum << " tgtXtgt " << totalTgtXTgt << " tgtSum " << totalTgtSum << endl;
-	    DOUT << "sqrt1: " << totalNonInf*totalUncXUnc - totalUncSum*totalUncSum << " sqrt2: " << totalNonInf*totalTgtXTgt - totalTgtSum*totalTgtSum << endl;
-	    DOUT << "corrNum: " << corrNum << " corrDen: " << corrDen << " corr: " << corrNum/corrDen << endl;
-	    
-	    if (corrDen != 0) {
-	       cout << setw(padW) << corrNum/corrDen;
-	    } else {
-	       cout << setw(padW) << 0;
-	    }
+   size_t numThreads = result["jobs"].as<size_t>();
+   if (numThreads == 0) {
+      numThreads = max(thread::hardware_concurrency(), 1u);
+   }
+
+   size_t lockstep = result["lockstep"].as<size_t>();
+   if (result.count("queue")) {
+      if (lockstep > 1 or result["halving"].as<size_t>() > 1) {
+	 cerr << "--queue cannot be combined with --lockstep or --halving." << endl;
+	 exit(1);
+      }
+      runQueue(result, configNames, configs, numThreads);
+      return;
+   }
+   if (result["halving"].as<size_t>() > 1) {
+      if (lockstep > 1) {
+	 cerr << "--halving and --lockstep cannot be used together." << endl;
+	 exit(1);
+      }
+      runHalving(result, configNames, configs, numThreads);
+      return;
+   }
+
+   // Each job is a single run or a group of runs that share an experience stream
+   vector<vector<size_t> > jobs;
+   map<string, size_t> openJobs;
+   for (size_t i = 0; i < configs.size(); ++i) {
+      string key = lockstep > 1 ? Lockstep::getStreamKey(configs[i]) : "";
+      if (key.empty()) {
+	 jobs.push_back({i});
+	 continue;
+      }
+
+      auto openJob = openJobs.find(key);
+      if (openJob == openJobs.end() or jobs[openJob->second].size() >= lockstep) {
+	 openJobs[key] = jobs.size();
+	 jobs.push_back({i});
+      } else {
+	 jobs[openJob->second].push_back(i);
+      }
+   }
+
+   size_t numDone = 0;
+   mutex progressMutex;
+
+   runParallel(jobs.size(), numThreads, [&](size_t j) {
+      if (jobs[j].size() == 1) {
+	 Experiment experiment(configs[jobs[j][0]]);
+	 experiment.run();
+      } else {
+	 vector<Config> jobConfigs;
+	 for (auto i : jobs[j]) {
+	    jobConfigs.push_back(configs[i]);
 	 }
+	 Lockstep lockstepRuns(jobConfigs);
+	 lockstepRuns.run();
+      }
+
+      lock_guard<mutex> lock(progressMutex);
+      for (auto i : jobs[j]) {
+	 ++numDone;
+	 cerr << "[" << numDone << "/" << configs.size() << "] " << configNames[i] << endl;
       }
-      cout << endl;
+   });
+}
+
+int main(int argc, char* argv[]) {
+   auto result = parseOptions(argc, argv);
+
+   if (result.count("config") + result.count("manifest") + result.count("serve") > 1) {
+      cerr << "Only one of --config, --manifest, and --serve can be used." << endl;
+      exit(1);
    }
-   delete env;
-   delete uncertainEnv;
-   delete agent;
-   for (auto traj : data) {
-      delete traj;
+
+   if (result.count("trace")) {
+#ifndef TRACE
+      cerr << "--trace needs a build configured with -DTRACING=ON." << endl;
+      exit(1);
+#endif
+      if (result.count("serve")) {
+	 cerr << "--trace cannot be used with --serve." << endl;
+	 exit(1);
+      }
+      Trace::enable(result["trace_events"].as<size_t>());
    }
-   delete model;
 
+   if (result.count("manifest")) {
+      runManifest(result);
+   } else if (result.count("serve")) {
+      size_t maxChildren = result["jobs"].as<size_t>();
+      if (maxChildren == 0) {
+	 maxChildren = max(thread::hardware_concurrency(), 1u);
+      }
 
-   std::cout.rdbuf(coutbuf);
-   outFile.close();
+      // Pay for libtorch's lazy initialization once, before any child is forked
+      torch::manual_seed(0);
+      torch::zeros({1});
+
+      ForkServer server(result["serve"].as<string>(), maxChildren);
+      server.serve([&](const string& configName) {
+	 Params params;
+	 readConfigFile(configName, params);
+	 resolveParams(result, params);
+	 Config config(params);
+	 if (!result["rerun"].as<bool>() and Experiment::isComplete(config)) {
+	    cerr << "Already complete: " << configName << endl;
+	    return;
+	 }
+	 Experiment experiment(config);
+	 experiment.run();
+      });
+   } else {
+      Params params;
+      if (result.count("config")) {
+	 readConfigFile(result["config"].as<string>(), params);
+      }
+      resolveParams(result, params);
+
+      Config config(params);
+      if (!result["rerun"].as<bool>() and Experiment::isComplete(config)) {
+	 cerr << "Already complete: " << config.output << endl;
+	 return 0;
+      }
+      Experiment experiment(config);
+      experiment.run();
+   }
+
+   if (result.count("trace")) {
+      Trace::write(result["trace"].as<string>());
+   }
 }
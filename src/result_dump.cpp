@@ -0,0 +1,54 @@
+#include "ResultFile.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Prints a binary result file as a whitespace table like the .result text
+// output, optionally restricted to the named columns.
+int main(int argc, char** argv) {
+   if (argc < 2) {
+      cerr << "Usage: " << argv[0] << " <file.result.bin> [column ...]" << endl;
+      return 1;
+   }
+
+   ResultReader reader(argv[1]);
+
+   vector<size_t> cols;
+   if (argc == 2) {
+      for (size_t c = 0; c < reader.getNumColumns(); ++c) {
+	 cols.push_back(c);
+      }
+   } else {
+      for (int a = 2; a < argc; ++a) {
+	 size_t c = reader.getColumnIndex(argv[a]);
+	 if (c == reader.getNumColumns()) {
+	    cerr << "No column " << argv[a] << " in " << argv[1] << endl;
+	    return 1;
+	 }
+	 cols.push_back(c);
+      }
+   }
+
+   size_t padW = 15;
+   for (auto c : cols) {
+      cout << setw(padW) << to_string(c + 1) + "_" + reader.getColumnName(c);
+   }
+   cout << endl;
+
+   for (size_t r = 0; r < reader.getNumRows(); ++r) {
+      for (auto c : cols) {
+	 if (reader.getColumnType(c) == intColumn) {
+	    cout << setw(padW) << reader.getInt(r, c);
+	 } else {
+	    cout << setw(padW) << reader.getFloat(r, c);
+	 }
+      }
+      cout << endl;
+   }
+
+   return 0;
+}
@@ -0,0 +1,155 @@
+#include "ParticlePopulation.hpp"
+
+#include <algorithm>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+using namespace std;
+
+static const size_t lineFloats = 64/sizeof(rlfloat_t);
+static const size_t numLanes = 8;
+
+ParticlePopulation::ParticlePopulation() :
+   numSamples_(0),
+   stateDim_(0),
+   nextStateDim_(0),
+   horizon_(0),
+   stride_(0) {
+}
+
+void ParticlePopulation::resize(size_t numSamples, size_t stateDim, size_t horizon) {
+   numSamples_ = numSamples;
+   stateDim_ = stateDim;
+   nextStateDim_ = stateDim;
+   horizon_ = horizon;
+   stride_ = (numSamples + lineFloats - 1)/lineFloats*lineFloats;
+
+   states_.resize(stateDim*stride_);
+   nextStates_.resize(stateDim*stride_);
+   rewards_.resize(stride_);
+   terms_.resize(stride_);
+   returns_.resize(stride_);
+   targets_.resize(horizon*stride_);
+   actions_.resize(numSamples);
+   alive_.resize(numSamples);
+}
+
+void ParticlePopulation::getState(size_t j, State& state) const {
+   state.resize(stateDim_);
+   for (size_t d = 0; d < stateDim_; ++d) {
+      state[d] = states_[d*stride_ + j];
+   }
+}
+
+void ParticlePopulation::fillStates(const State& state) {
+   for (size_t d = 0; d < stateDim_; ++d) {
+      fill(getDim(d), getDim(d) + numSamples_, state[d]);
+   }
+}
+
+void ParticlePopulation::setNextStateDim(size_t stateDim) {
+   nextStateDim_ = stateDim;
+   nextStates_.resize(stateDim*stride_);
+}
+
+void ParticlePopulation::setNextState(size_t j, const State& state) {
+   for (size_t d = 0; d < nextStateDim_; ++d) {
+      nextStates_[d*stride_ + j] = state[d];
+   }
+}
+
+void ParticlePopulation::keepState(size_t j) {
+   for (size_t d = 0; d < min(stateDim_, nextStateDim_); ++d) {
+      nextStates_[d*stride_ + j] = states_[d*stride_ + j];
+   }
+}
+
+void ParticlePopulation::advance() {
+   states_.swap(nextStates_);
+   swap(stateDim_, nextStateDim_);
+   setNextStateDim(stateDim_);
+}
+
+void ParticlePopulation::getMeanState(State& mean) const {
+   mean.resize(stateDim_);
+   for (size_t d = 0; d < stateDim_; ++d) {
+      mean[d] = sum(getDim(d), numSamples_)/numSamples_;
+   }
+}
+
+rlfloat_t ParticlePopulation::sum(const rlfloat_t* values, size_t n) {
+   rlfloat_t lanes[numLanes] = {};
+   size_t j = 0;
+   for (; j + numLanes <= n; j += numLanes) {
+      for (size_t l = 0; l < numLanes; ++l) {
+	 lanes[l] += values[j + l];
+      }
+   }
+   for (; j < n; ++j) {
+      lanes[j % numLanes] += values[j];
+   }
+
+   rlfloat_t total = 0;
+   for (size_t l = 0; l < numLanes; ++l) {
+      total += lanes[l];
+   }
+   return total;
+}
+
+Bound ParticlePopulation::getRange(const rlfloat_t* values, size_t n) {
+   if (n == 0) {
+      return {0, 0};
+   }
+
+   Bound range{values[0], values[0]};
+   size_t j = 0;
+#ifdef __SSE__
+   // The compiler only vectorizes float min and max when told to ignore NaNs
+   // and signed zeros, so here it is done by hand
+   static_assert(sizeof(rlfloat_t) == sizeof(float), "The SSE range assumes single precision");
+   if (n >= 4) {
+      __m128 lower = _mm_loadu_ps(values);
+      __m128 upper = lower;
+      for (j = 4; j + 4 <= n; j += 4) {
+	 __m128 v = _mm_loadu_ps(values + j);
+	 lower = _mm_min_ps(lower, v);
+	 upper = _mm_max_ps(upper, v);
+      }
+      float lowerLanes[4];
+      float upperLanes[4];
+      _mm_storeu_ps(lowerLanes, lower);
+      _mm_storeu_ps(upperLanes, upper);
+      for (size_t l = 0; l < 4; ++l) {
+	 range.lower = min(range.lower, lowerLanes[l]);
+	 range.upper = max(range.upper, upperLanes[l]);
+      }
+   }
+#endif
+   for (; j < n; ++j) {
+      range.lower = min(range.lower, values[j]);
+      range.upper = max(range.upper, values[j]);
+   }
+   return range;
+}
+
+rlfloat_t ParticlePopulation::sumSquaredDiff(const rlfloat_t* values, size_t n, rlfloat_t center) {
+   rlfloat_t lanes[numLanes] = {};
+   size_t j = 0;
+   for (; j + numLanes <= n; j += numLanes) {
+      for (size_t l = 0; l < numLanes; ++l) {
+	 rlfloat_t diff = values[j + l] - center;
+	 lanes[l] += diff*diff;
+      }
+   }
+   for (; j < n; ++j) {
+      rlfloat_t diff = values[j] - center;
+      lanes[j % numLanes] += diff*diff;
+   }
+
+   rlfloat_t total = 0;
+   for (size_t l = 0; l < numLanes; ++l) {
+      total += lanes[l];
+   }
+   return total;
+}
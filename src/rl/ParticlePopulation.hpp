@@ -0,0 +1,84 @@
+#ifndef PARTICLE_POPULATION
+#define PARTICLE_POPULATION
+
+#include "RLTypes.hpp"
+#include "AlignedAllocator.hpp"
+
+#include <vector>
+#include <cstddef>
+
+// The samples of a Monte Carlo rollout, stored as structure of arrays: one
+// contiguous, cache-line aligned array per state dimension, and one each for
+// the samples' last rewards and terminations, discounted returns, next
+// actions, whether they are still going, and their targets at each step of
+// the horizon. The arrays keep their capacity when resized, so one population
+// can be reused for every rollout a learner does.
+class ParticlePopulation {
+  public:
+   typedef std::vector<rlfloat_t, AlignedAllocator<rlfloat_t, 64> > Array;
+
+   ParticlePopulation();
+
+   // Contents are left unspecified
+   void resize(std::size_t numSamples, std::size_t stateDim, std::size_t horizon);
+
+   std::size_t getNumSamples() const {return numSamples_;}
+   std::size_t getStateDim() const {return stateDim_;}
+   std::size_t getHorizon() const {return horizon_;}
+
+   rlfloat_t* getDim(std::size_t d) {return states_.data() + d*stride_;}
+   const rlfloat_t* getDim(std::size_t d) const {return states_.data() + d*stride_;}
+   rlfloat_t* getRewards() {return rewards_.data();}
+   const rlfloat_t* getRewards() const {return rewards_.data();}
+   rlfloat_t* getTerms() {return terms_.data();}
+   const rlfloat_t* getTerms() const {return terms_.data();}
+   rlfloat_t* getReturns() {return returns_.data();}
+   rlfloat_t* getTargets(std::size_t step) {return targets_.data() + step*stride_;}
+   const rlfloat_t* getTargets(std::size_t step) const {return targets_.data() + step*stride_;}
+   act_t* getActions() {return actions_.data();}
+   unsigned char* getAlive() {return alive_.data();}
+
+   // Copies sample j's current state out of the dimension arrays
+   void getState(std::size_t j, State& state) const;
+   // Every sample's current state set to state
+   void fillStates(const State& state);
+
+   // The next states are written beside the current ones, since a model's
+   // states need not be the size of the observed ones (part of the state can
+   // be hidden from it). The size must be set before any are written.
+   void setNextStateDim(std::size_t stateDim);
+   void setNextState(std::size_t j, const State& state);
+   // Sample j's next state is its current one (as far as the sizes allow)
+   void keepState(std::size_t j);
+   // The next states become the current ones
+   void advance();
+   // Each dimension's mean over the samples
+   void getMeanState(State& mean) const;
+
+   // Reductions over n values, written to run on vector registers. The sums
+   // are split over a fixed number of lanes that are combined in a fixed
+   // order, so they do not depend on the build's vector width.
+   static rlfloat_t sum(const rlfloat_t* values, std::size_t n);
+   static Bound getRange(const rlfloat_t* values, std::size_t n);
+   // The sum of (value - center)^2
+   static rlfloat_t sumSquaredDiff(const rlfloat_t* values, std::size_t n, rlfloat_t center);
+
+  private:
+   std::size_t numSamples_;
+   std::size_t stateDim_;
+   std::size_t nextStateDim_;
+   std::size_t horizon_;
+   // numSamples_ rounded up to a whole number of cache lines
+   std::size_t stride_;
+
+   Array states_;
+   Array nextStates_;
+   Array rewards_;
+   Array terms_;
+   Array returns_;
+   Array targets_;
+   std::vector<act_t> actions_;
+   std::vector<unsigned char> alive_;
+};
+
+#endif
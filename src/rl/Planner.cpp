@@ -0,0 +1,154 @@
+#include "Planner.hpp"
+
+#include <iostream>
+#include <limits>
+#include <map>
+#include <vector>
+
+using namespace std;
+
+static void qLearningUpdate(QLearner& agent,
+			    const Trajectory& traj,
+			    size_t t,
+			    BBIPredictionModel*,
+			    PredictionModel*,
+			    BBIPredictionModel*,
+			    QLearner::Measurements&) {
+   agent.qUpdate(traj, t);
+}
+
+// Plans with the true environment
+static void perfectModelUpdate(QLearner& agent,
+			       const Trajectory& traj,
+			       size_t t,
+			       BBIPredictionModel*,
+			       PredictionModel* env,
+			       BBIPredictionModel*,
+			       QLearner::Measurements& measurements) {
+   agent.mveUpdate(traj, t, env, measurements);
+}
+
+static void mveUpdate(QLearner& agent,
+		      const Trajectory& traj,
+		      size_t t,
+		      BBIPredictionModel* model,
+		      PredictionModel* env,
+		      BBIPredictionModel*,
+		      QLearner::Measurements& measurements) {
+   agent.mveUpdate(traj, t, model, env, measurements);
+}
+
+static void oneStepUncertaintyUpdate(QLearner& agent,
+				     const Trajectory& traj,
+				     size_t t,
+				     BBIPredictionModel* model,
+				     PredictionModel* env,
+				     BBIPredictionModel* uncertainEnv,
+				     QLearner::Measurements& measurements) {
+   agent.oneStepUncertaintySMVEUpdate(traj, t, model, env, uncertainEnv, measurements);
+}
+
+static void targetRangeUpdate(QLearner& agent,
+			      const Trajectory& traj,
+			      size_t t,
+			      BBIPredictionModel* model,
+			      PredictionModel* env,
+			      BBIPredictionModel* uncertainEnv,
+			      QLearner::Measurements& measurements) {
+   agent.targetRangeSMVEUpdate(traj, t, model, env, uncertainEnv, measurements);
+}
+
+static void monteCarloUpdate(QLearner& agent,
+			     const Trajectory& traj,
+			     size_t t,
+			     BBIPredictionModel* model,
+			     PredictionModel* env,
+			     BBIPredictionModel* uncertainEnv,
+			     QLearner::Measurements& measurements) {
+   agent.monteCarloSMVEUpdate(traj, t, model, env, uncertainEnv, measurements);
+}
+
+static map<string, Planner> buildRegistry() {
+   const Planner::ModelTarget mean = Planner::meanTarget;
+   const Planner::ModelTarget variance = Planner::varianceTarget;
+   const Planner::ModelTarget bound = Planner::boundTarget;
+   const Planner::ModelTarget sample = Planner::sampleTarget;
+
+   vector<Planner> planners({
+	 // name     update                    target    learns plans oracle isI  single incRwd incState var  dir  reject
+	 {"Q",      qLearningUpdate,          mean,     true,  false, false, false, true,  false, true,  false, false, false},
+	 {"P",      perfectModelUpdate,       mean,     false, false, false, false, true,  false, true,  false, false, false},
+	 {"A",      mveUpdate,                mean,     true,  true,  false, false, true,  false, true,  false, false, false},
+	 {"E",      mveUpdate,                mean,     true,  true,  true,  false, true,  false, true,  false, false, false},
+
+	 {"SV",     oneStepUncertaintyUpdate, variance, true,  true,  true,  false, false, false, true,  false, false, false},
+	 {"RV",     oneStepUncertaintyUpdate, variance, true,  true,  true,  false, false, true,  false, true,  false, false},
+	 {"SRV",    oneStepUncertaintyUpdate, variance, true,  true,  true,  false, false, true,  true,  true,  false, false},
+	 {"SR",     oneStepUncertaintyUpdate, bound,    true,  true,  true,  false, false, false, true,  false, false, false},
+	 {"RR",     oneStepUncertaintyUpdate, bound,    true,  true,  true,  false, false, true,  false, false, false, false},
+	 {"SRR",    oneStepUncertaintyUpdate, bound,    true,  true,  true,  false, false, true,  true,  false, false, false},
+
+	 {"TR",     targetRangeUpdate,        bound,    true,  true,  true,  false, false, false, true,  false, false, false},
+	 {"TDR",    targetRangeUpdate,        bound,    true,  true,  true,  false, false, false, true,  false, true,  false},
+	 {"TOR",    targetRangeUpdate,        bound,    true,  true,  true,  false, false, false, true,  false, false, true},
+	 // The old planner lists never turned on directional_range for TDOR; kept so results stay comparable
+	 {"TDOR",   targetRangeUpdate,        bound,    true,  true,  true,  false, false, false, true,  false, false, true},
+
+	 {"S",      monteCarloUpdate,         sample,   true,  true,  true,  false, true,  false, true,  false, false, false},
+	 {"MCTV",   monteCarloUpdate,         sample,   true,  true,  true,  false, false, false, true,  true,  false, false},
+	 {"MCTR",   monteCarloUpdate,         sample,   true,  true,  true,  false, false, false, true,  false, false, false},
+	 {"MCTDR",  monteCarloUpdate,         sample,   true,  true,  true,  false, false, false, true,  false, true,  false},
+	 {"MCTOR",  monteCarloUpdate,         sample,   true,  true,  true,  false, false, false, true,  false, false, true},
+	 {"MCTDOR", monteCarloUpdate,         sample,   true,  true,  true,  false, false, false, true,  false, true,  true}
+      });
+
+   map<string, Planner> registry;
+   for (auto planner : planners) {
+      registry[planner.name] = planner;
+      if (planner.hasOracle) {
+	 planner.name = "I" + planner.name;
+	 planner.oracle = true;
+	 registry[planner.name] = planner;
+      }
+   }
+   return registry;
+}
+
+const Planner& Planner::get(const string& name) {
+   static const map<string, Planner> registry = buildRegistry();
+
+   auto planner = registry.find(name);
+   if (planner == registry.end()) {
+      cerr << "Planner " << name << " not recognized." << endl;
+      exit(1);
+   }
+   return planner->second;
+}
+
+void Planner::applyOptions(Params& params) const {
+   if (singleSample) {
+      params.setInt("num_samples", 1);
+      params.setFloat("temperature", numeric_limits<double>::infinity());
+   }
+   params.setInt("inc_rwd", incRwd);
+   params.setInt("inc_state", incState);
+   params.setInt("use_variance", useVariance);
+   params.setInt("directional_range", directionalRange);
+   params.setInt("reject_overlap", rejectOverlap);
+}
+
+NNModel::TrainingType Planner::getTrainingType(const Config& config) const {
+   if (modelTarget == varianceTarget) {
+      return NNModel::gaussian;
+   } else if (modelTarget == boundTarget) {
+      return NNModel::bound;
+   } else if (modelTarget == sampleTarget) {
+      if (config.useGaussian) {
+	 return NNModel::gaussian;
+      } else {
+	 return NNModel::iqn;
+      }
+   } else {
+      return NNModel::mse;
+   }
+}
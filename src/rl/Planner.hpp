@@ -0,0 +1,53 @@
+#ifndef PLANNER
+#define PLANNER
+
+#include "QLearner.hpp"
+#include "Trajectory.hpp"
+#include "PredictionModel.hpp"
+#include "NNModel.hpp"
+#include "Params.hpp"
+#include "Config.hpp"
+
+#include <string>
+
+// Everything a planner name (e.g. "MCTDR") implies: the QLearner update it
+// runs, what the learned model must predict for it, and the settings it
+// forces. Names are resolved once with Planner::get. Any planner with an
+// oracle variant can be prefixed with "I" to plan with the hand-coded model
+// instead of the learned one.
+struct Planner {
+   enum ModelTarget {meanTarget, varianceTarget, boundTarget, sampleTarget};
+
+   typedef void (*UpdateFn)(QLearner& agent,
+			    const Trajectory& traj,
+			    std::size_t t,
+			    BBIPredictionModel* model,
+			    PredictionModel* env,
+			    BBIPredictionModel* uncertainEnv,
+			    QLearner::Measurements& measurements);
+
+   std::string name;
+   UpdateFn update;
+   ModelTarget modelTarget;
+
+   bool learnsModel;      // Feeds experience to the learned model
+   bool plansWithModel;   // Plans with a model, so falls back on Q-learning until it is ready
+   bool hasOracle;        // Has an "I" variant
+   bool oracle;           // Is the "I" variant
+
+   bool singleSample;     // Forces num_samples = 1 and an infinite temperature
+   bool incRwd;
+   bool incState;
+   bool useVariance;
+   bool directionalRange;
+   bool rejectOverlap;
+
+   // Exits if the name is not recognized
+   static const Planner& get(const std::string& name);
+
+   // Overwrites the settings this planner forces, even if explicitly provided
+   void applyOptions(Params& params) const;
+   NNModel::TrainingType getTrainingType(const Config& config) const;
+};
+
+#endif
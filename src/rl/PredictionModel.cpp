@@ -21,7 +21,7 @@ void PredictionModel::getStateDistribution(const State& premise, act_t action, S
    }
 }
 
-void PredictionModel::getStatePredSample(const State& premise, act_t action, State& sample) const {
+void PredictionModel::getStatePredSample(const State& premise, act_t action, State& sample, RNG&) const {
    getStatePrediction(premise, action, sample);
 }
 
@@ -36,7 +36,7 @@ void PredictionModel::getRewardDistribution(const State& premise, act_t action,
    rewardDist = {pred, 0};
 }
 
-rlfloat_t PredictionModel::getRewardPredSample(const State& premise, act_t action) const {
+rlfloat_t PredictionModel::getRewardPredSample(const State& premise, act_t action, RNG&) const {
    return getRewardPrediction(premise, action);
 }
 
@@ -51,6 +51,69 @@ void PredictionModel::getTermDistribution(const State& premise, act_t action, No
    termDist = {pred, 0};
 }
 
-bool PredictionModel::getTermPredSample(const State& premise, act_t action) const {
+bool PredictionModel::getTermPredSample(const State& premise, act_t action, RNG&) const {
    return getTermPrediction(premise, action) > 0.5;
 }
+
+void PredictionModel::getStatePredictionBatch(const vector<State>& premises, const vector<act_t>& actions, vector<State>& predictedStates) const {
+   predictedStates.resize(premises.size());
+   for (size_t k = 0; k < premises.size(); ++k) {
+      getStatePrediction(premises[k], actions[k], predictedStates[k]);
+   }
+}
+
+void PredictionModel::getRewardPredictionBatch(const vector<State>& premises, const vector<act_t>& actions, vector<rlfloat_t>& rewards) const {
+   rewards.resize(premises.size());
+   for (size_t k = 0; k < premises.size(); ++k) {
+      rewards[k] = getRewardPrediction(premises[k], actions[k]);
+   }
+}
+
+void PredictionModel::getTermPredictionBatch(const vector<State>& premises, const vector<act_t>& actions, vector<rlfloat_t>& terms) const {
+   terms.resize(premises.size());
+   for (size_t k = 0; k < premises.size(); ++k) {
+      terms[k] = getTermPrediction(premises[k], actions[k]);
+   }
+}
+
+void PredictionModel::getStatePredSampleBatch(const vector<State>& premises, const vector<act_t>& actions, vector<State>& samples, const vector<RNG*>& rngs) const {
+   samples.resize(premises.size());
+   for (size_t k = 0; k < premises.size(); ++k) {
+      getStatePredSample(premises[k], actions[k], samples[k], *rngs[k]);
+   }
+}
+
+void PredictionModel::getRewardPredSampleBatch(const vector<State>& premises, const vector<act_t>& actions, vector<rlfloat_t>& rewards, const vector<RNG*>& rngs) const {
+   rewards.resize(premises.size());
+   for (size_t k = 0; k < premises.size(); ++k) {
+      rewards[k] = getRewardPredSample(premises[k], actions[k], *rngs[k]);
+   }
+}
+
+void PredictionModel::getTermPredSampleBatch(const vector<State>& premises, const vector<act_t>& actions, vector<rlfloat_t>& terms, const vector<RNG*>& rngs) const {
+   terms.resize(premises.size());
+   for (size_t k = 0; k < premises.size(); ++k) {
+      terms[k] = getTermPredSample(premises[k], actions[k], *rngs[k]);
+   }
+}
+
+void BBIPredictionModel::getStateBoundsBatch(const vector<StateBound>& premises, const vector<vector<act_t> >& actions, vector<StateBound>& predictedBounds) const {
+   predictedBounds.resize(premises.size());
+   for (size_t k = 0; k < premises.size(); ++k) {
+      getStateBounds(premises[k], actions[k], predictedBounds[k]);
+   }
+}
+
+void BBIPredictionModel::getRewardBoundsBatch(const vector<StateBound>& premises, const vector<vector<act_t> >& actions, vector<Bound>& rewardBounds) const {
+   rewardBounds.resize(premises.size());
+   for (size_t k = 0; k < premises.size(); ++k) {
+      getRewardBounds(premises[k], actions[k], rewardBounds[k]);
+   }
+}
+
+void BBIPredictionModel::getTermBoundsBatch(const vector<StateBound>& premises, const vector<vector<act_t> >& actions, vector<Bound>& termBounds) const {
+   termBounds.resize(premises.size());
+   for (size_t k = 0; k < premises.size(); ++k) {
+      getTermBounds(premises[k], actions[k], termBounds[k]);
+   }
+}
@@ -3,6 +3,7 @@
 
 #include "Trajectory.hpp"
 #include "RLTypes.hpp"
+#include "Checkpoint.hpp"
 
 #include <iostream>
 #include <vector>
@@ -15,17 +16,41 @@ class PredictionModel {
    virtual void getStatePrediction(const State& premise, act_t action, State& predictedState) const = 0;
    virtual void getStateBounds(const State& premise, act_t action, State& predictedState, StateBound& predictedBounds) const;
    virtual void getStateDistribution(const State& premise, act_t action, StateNormal& stateDist) const;
-   virtual void getStatePredSample(const State& premise, act_t action, State& sample) const;
+   virtual void getStatePredSample(const State& premise, act_t action, State& sample, RNG& rng) const;
    
    virtual rlfloat_t getRewardPrediction(const State& premise, act_t action) const = 0;
    virtual rlfloat_t getRewardBounds(const State& premise, act_t action, Bound& rewardBound) const;
    virtual void getRewardDistribution(const State& premise, act_t action, Normal& rewardDist) const;
-   virtual rlfloat_t getRewardPredSample(const State& premise, act_t action) const;
+   virtual rlfloat_t getRewardPredSample(const State& premise, act_t action, RNG& rng) const;
    
    virtual rlfloat_t getTermPrediction(const State& premise, act_t action) const = 0;
    virtual rlfloat_t getTermBounds(const State& premise, act_t action, Bound& termBound) const;
    virtual void getTermDistribution(const State& premise, act_t action, Normal& termDist) const;
-   virtual bool getTermPredSample(const State& premise, act_t action) const;
+   virtual bool getTermPredSample(const State& premise, act_t action, RNG& rng) const;
+
+   // The above for premises[k] and actions[k], with the results in the kth
+   // entries. These loop over the single versions unless a model can do
+   // better, e.g. with one pass of a network over the whole batch.
+   virtual void getStatePredictionBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<State>& predictedStates) const;
+   virtual void getRewardPredictionBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<rlfloat_t>& rewards) const;
+   virtual void getTermPredictionBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<rlfloat_t>& terms) const;
+   // Premise k draws from *rngs[k], and from it alone, as the single
+   // versions would, so batching leaves the samples as they were
+   virtual void getStatePredSampleBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<State>& samples, const std::vector<RNG*>& rngs) const;
+   virtual void getRewardPredSampleBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<rlfloat_t>& rewards, const std::vector<RNG*>& rngs) const;
+   // 1 where the sample terminates, 0 otherwise
+   virtual void getTermPredSampleBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<rlfloat_t>& terms, const std::vector<RNG*>& rngs) const;
+
+   // Whether the sample functions above may be called from several threads at
+   // once, each with its own generator
+   virtual bool canSampleConcurrently() const {return true;}
+
+   // Adds the nodes and bytes the model has learned (nothing by default)
+   virtual void addFootprint(Footprint&) const {}
+
+   // Whatever the model carries from one call to the next (nothing by default)
+   virtual void save(CheckpointWriter&) const {}
+   virtual void load(CheckpointReader&) {}
 };
 
 class LearnedModel : virtual public PredictionModel {
@@ -35,6 +60,9 @@ class LearnedModel : virtual public PredictionModel {
    virtual void removeTrajectory(const Trajectory* traj) = 0;
    
    virtual void updatePredictions() = 0;
+
+   // Leaves of the trees the model is made of, if any
+   virtual std::size_t getNumLeaves() const {return 0;}
 };
 
 class BBIPredictionModel : virtual public PredictionModel {
@@ -50,6 +78,12 @@ class BBIPredictionModel : virtual public PredictionModel {
    using PredictionModel::getTermBounds;
    virtual void getTermBounds(const StateBound& premise, const std::vector<act_t>& action, Bound& termBound) const = 0;
    virtual void getTermBounds(const StateBound& premise, act_t action, Bound& termBound) const {getTermBounds(premise, std::vector<act_t>(1, action), termBound);}
+
+   // The bounds for boxes premises[k] under action sets actions[k]; these
+   // loop over the single versions unless a model can do better
+   virtual void getStateBoundsBatch(const std::vector<StateBound>& premises, const std::vector<std::vector<act_t> >& actions, std::vector<StateBound>& predictedBounds) const;
+   virtual void getRewardBoundsBatch(const std::vector<StateBound>& premises, const std::vector<std::vector<act_t> >& actions, std::vector<Bound>& rewardBounds) const;
+   virtual void getTermBoundsBatch(const std::vector<StateBound>& premises, const std::vector<std::vector<act_t> >& actions, std::vector<Bound>& termBounds) const;
 };
 
 #endif
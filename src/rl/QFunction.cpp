@@ -16,6 +16,14 @@ SumQ::~SumQ() {
    }
 }
 
+QFunction* SumQ::clone() const {
+   vector<QFunction*> qFuncs;
+   for (auto q : qFuncs_) {
+      qFuncs.push_back(q->clone());
+   }
+   return new SumQ(qFuncs, numActions_);
+}
+
 float SumQ::getQ(const State& state, act_t action) const {
    float qVal = 0;
    for (auto q : qFuncs_) {
@@ -72,3 +80,21 @@ float SumQ::getStepSizeNormalizer() const {
    }
    return norm;
 }
+
+void SumQ::addFootprint(Footprint& footprint) const {
+   for (auto q : qFuncs_) {
+      q->addFootprint(footprint);
+   }
+}
+
+void SumQ::save(CheckpointWriter& out) const {
+   for (auto q : qFuncs_) {
+      q->save(out);
+   }
+}
+
+void SumQ::load(CheckpointReader& in) {
+   for (auto q : qFuncs_) {
+      q->load(in);
+   }
+}
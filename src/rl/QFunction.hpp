@@ -2,6 +2,8 @@
 #define Q_FUNCTION
 
 #include "RLTypes.hpp"
+#include "Checkpoint.hpp"
+#include "Footprint.hpp"
 
 #include <vector>
 #include <tuple>
@@ -17,6 +19,16 @@ class QFunction {
 
    virtual void updateQ(const State& state, act_t action, float change) = 0;
    virtual float getStepSizeNormalizer() const = 0;
+
+   // Independent deep copy, e.g. a snapshot to evaluate while learning goes on
+   virtual QFunction* clone() const = 0;
+
+   // Adds the nodes and bytes this Q-function holds (nothing by default)
+   virtual void addFootprint(Footprint&) const {}
+
+   // Learned state only; the structure comes from the constructor
+   virtual void save(CheckpointWriter& out) const = 0;
+   virtual void load(CheckpointReader& in) = 0;
 };
 
 class SumQ : public QFunction
@@ -34,6 +46,13 @@ class SumQ : public QFunction
    virtual void updateQ(const State& state, act_t action, float change);   
    virtual float getStepSizeNormalizer() const;
 
+   virtual QFunction* clone() const;
+
+   virtual void addFootprint(Footprint& footprint) const;
+
+   virtual void save(CheckpointWriter& out) const;
+   virtual void load(CheckpointReader& in);
+
   protected:
    std::vector<QFunction*> qFuncs_;
    act_t numActions_;
@@ -1,7 +1,10 @@
 #include "QLearner.hpp"
 #include "dout.hpp"
+#include "Trace.hpp"
+#include "AllocStats.hpp"
 
 #include <cmath>
+#include <functional>
 #include <iostream>
 #include <string>
 
@@ -10,16 +13,18 @@ using namespace std;
 QLearner::QLearner(QFunction* qFunc,
                    act_t numActions,
 		   RNG& rng,
-		   const Params& params) :
+		   const Config& config) :
    qFunc_(qFunc),
-   initialStepsize_(params.getFloat("step_size")),
+   initialStepsize_(config.stepSize),
    numActions_(numActions),
    rng_(rng.randomInt()),
-   params_(params) {
+   config_(config),
+   rolloutPool_(new ThreadPool(config.rolloutThreads)) {
 }
 
 QLearner::~QLearner() {
    delete qFunc_;
+   delete rolloutPool_;
 }
 
 ///////////////////////////////
@@ -27,7 +32,7 @@ QLearner::~QLearner() {
 ///////////////////////////////
 void QLearner::qUpdate(const Trajectory &traj, size_t t)
 {
-   rlfloat_t discount = params_.getFloat("discount");
+   rlfloat_t discount = config_.discount;
 
    act_t greedyAct = 0; //Default values if game is over
    rlfloat_t greedyQ = 0;
@@ -59,26 +64,43 @@ act_t QLearner::getGreedyAction(const State &s, rlfloat_t& qVal) const {
 }
 
 tuple<act_t, rlfloat_t> QLearner::greedy(const State& state) const {
-   vector<rlfloat_t> qVals;
-   qFunc_->getAllActQs(state, qVals);
+   return greedy(*qFunc_, numActions_, rng_, state);
+}
+
+tuple<act_t, rlfloat_t> QLearner::greedy(const QFunction& qFunc, act_t numActions, RNG& rng, const State& state) {
+   TRACE_SCOPE("greedy");
+   // One per thread, since the samples of a rollout can run on several
+   static thread_local vector<rlfloat_t> qVals;
+   qFunc.getAllActQs(state, qVals);
 
+   // The tied actions are the one that set the greatest value and those
+   // after it within 1e-6 of it, so they are counted rather than collected
+   // and the chosen one is found in a second pass
    rlfloat_t greedyQ = -numeric_limits<rlfloat_t>::infinity();
-   vector<act_t> greedyActs;
-   for (act_t a = 0; a < numActions_; a++) {
+   act_t firstGreedyAct = 0;
+   act_t numGreedyActs = 0;
+   for (act_t a = 0; a < numActions; a++) {
       rlfloat_t q = qVals[a];
       
       DOUT << "a " << a << " q " << q << endl;
       
       if (q > greedyQ) {
-         greedyActs.clear();
-         greedyActs.push_back(a);
+         firstGreedyAct = a;
+         numGreedyActs = 1;
          greedyQ = q;
       } else if (fabs(q - greedyQ) < 1e-6) {
-         greedyActs.push_back(a);
+         ++numGreedyActs;
       }
    }
 
-   act_t act = greedyActs[static_cast<act_t>(rng_.randomFloat()*greedyActs.size())];
+   act_t pick = static_cast<act_t>(rng.randomFloat()*numGreedyActs);
+   act_t act = firstGreedyAct;
+   for (act_t a = firstGreedyAct + 1; pick > 0; ++a) {
+      if (fabs(qVals[a] - greedyQ) < 1e-6) {
+	 act = a;
+	 --pick;
+      }
+   }
    return make_tuple(act, greedyQ);
 }
 
@@ -90,7 +112,8 @@ void QLearner::mveUpdate(const Trajectory& traj,
 			 PredictionModel* model,
 			 PredictionModel* env,
 			 Measurements& measurements) {
-   size_t horizon = params_.getInt("horizon");
+   TRACE_SCOPE("mveUpdate");
+   size_t horizon = config_.horizon;
 
    if (traj.getResultGameOver(t)) { // Episode has terminated so we can just update and leave.
       qUpdate(traj, t);
@@ -119,7 +142,7 @@ void QLearner::mveUpdate(const Trajectory& traj,
    }
    DOUT << endl;   
 
-   if (env != nullptr) {
+   if (env != nullptr and measurements.measureErrors) {
       RNG curRNG = rng_; 
       rng_ = rngCopy;      // Reset the RNG so random tie breaking is the same
       measurePredictionError(traj, t, env, measurements);
@@ -134,12 +157,16 @@ void QLearner::expectationRollout(const Trajectory& traj,
 				  size_t horizon,
 				  PredictionModel* model,
 				  Measurements& measurements) {
-   rlfloat_t discount = params_.getFloat("discount");
+   TRACE_SCOPE("expectationRollout");
+   rlfloat_t discount = config_.discount;
+
+   State& curS = workspace_.curS;
+   State& nextS = workspace_.nextS;
 
    vector<State>& states = measurements.states;
-   states.clear();
-   State curS = traj.getResultState(t);
-   states.push_back(curS);
+   measurements.clearStates(states);
+   curS = traj.getResultState(t);
+   measurements.addState(states) = curS;
    
    vector<rlfloat_t>& rewards = measurements.rewards;
    rewards.clear();
@@ -166,7 +193,7 @@ void QLearner::expectationRollout(const Trajectory& traj,
       }
       DOUT << endl;
       
-      State nextS = curS;      
+      nextS = curS;
       bool nextTerminated = true;
       rlfloat_t r = 0;
       rlfloat_t nextQ = 0;
@@ -199,7 +226,7 @@ void QLearner::expectationRollout(const Trajectory& traj,
 	 }
       }
 
-      states.push_back(nextS);
+      measurements.addState(states) = nextS;
       rewards.push_back(r);
       terms.push_back(nextTerm);
 
@@ -208,7 +235,7 @@ void QLearner::expectationRollout(const Trajectory& traj,
       targets.push_back(cumR + totalDiscount*nextQ);
     
       // increment s
-      curS = nextS;
+      swap(curS, nextS);
       action = nextAct;
 
       terminated = terminated or nextTerminated;
@@ -265,7 +292,8 @@ void QLearner::oneStepUncertaintySMVEUpdate(const Trajectory& traj,
 					    PredictionModel* env,
 					    BBIPredictionModel* uncertainEnv,
 					    Measurements& measurements) {
-   size_t horizon = params_.getInt("horizon");
+   TRACE_SCOPE("oneStepUncertaintySMVEUpdate");
+   size_t horizon = config_.horizon;
 
    if (traj.getResultGameOver(t)) { // Episode has terminated so we can just update and leave.
       qUpdate(traj, t);
@@ -289,18 +317,19 @@ void QLearner::oneStepUncertaintySMVEUpdate(const Trajectory& traj,
    }
    DOUT << endl;   
 
-   if (env != nullptr) {
+   if (env != nullptr and measurements.measureErrors) {
       RNG curRNG = rng_; 
       rng_ = copyRNG;      // Reset the RNG so random tie breaking is the same
       measurePredictionError(traj, t, env, measurements);
       rng_ = curRNG;       // Now put it back where it was after the original rollout
    }
 
-   if (uncertainEnv != nullptr) {
+   if (uncertainEnv != nullptr and measurements.measureErrors) {
       RNG curRNG = rng_; 
       rng_ = copyRNG;      // Reset the RNG so random tie breaking is the same
 
-      Measurements uncMeasurements;
+      Measurements& uncMeasurements = workspace_.envMeasurements;
+      uncMeasurements.clear();
       oneStepUncRollout(traj, t, horizon, uncertainEnv, uncMeasurements);
       
       rng_ = curRNG;       // Now put it back where it was after the original rollout
@@ -321,8 +350,8 @@ void QLearner::oneStepUncertaintySMVEUpdate(const Trajectory& traj,
 
 void QLearner::uncertaintiesToWeights(const vector<rlfloat_t>& uncertainties,
 				      vector<rlfloat_t>& weights) {
-   rlfloat_t temperature = params_.getFloat("temperature");
-   rlfloat_t decay = params_.getFloat("decay");
+   rlfloat_t temperature = config_.temperature;
+   rlfloat_t decay = config_.decay;
 
    rlfloat_t totalDecay = 1;
    for (auto u : uncertainties) {
@@ -336,14 +365,19 @@ void QLearner::oneStepUncRollout(const Trajectory& traj,
 				 size_t horizon,
 				 PredictionModel* model,
 				 Measurements&  measurements) {
-   rlfloat_t discount = params_.getFloat("discount");
-   bool incRwd = params_.getInt("inc_rwd");
-   bool incState = params_.getInt("inc_state");
+   TRACE_SCOPE("oneStepUncRollout");
+   rlfloat_t discount = config_.discount;
+   bool incRwd = config_.incRwd;
+   bool incState = config_.incState;
+
+   State& curS = workspace_.curS;
+   State& nextS = workspace_.nextS;
+   StatePredUnc& nextSPred = workspace_.nextSPred;
 
    vector<State>& states = measurements.states;
-   states.clear();
-   states.push_back(traj.getResultState(t));
-   State curS = traj.getResultState(t);
+   measurements.clearStates(states);
+   measurements.addState(states) = traj.getResultState(t);
+   curS = traj.getResultState(t);
 
    vector<rlfloat_t>& rewards = measurements.rewards;
    rewards.clear();
@@ -374,8 +408,8 @@ void QLearner::oneStepUncRollout(const Trajectory& traj,
       }
       DOUT << endl;
       
-      State nextS = curS;
-      StatePredUnc nextSPred;
+      nextS = curS;
+      nextSPred.clear();
       PredUnc rPred{0, 0};
       PredUnc nextTermPred;
       rlfloat_t nextQ = 0;
@@ -383,8 +417,9 @@ void QLearner::oneStepUncRollout(const Trajectory& traj,
       act_t nextAct = 0;
       
       if(!terminated) {
-	 if (params_.getInt("use_variance")) { // Variance
-	    StateNormal nextSDist;
+	 if (config_.useVariance) { // Variance
+	    StateNormal& nextSDist = workspace_.nextSDist;
+	    nextSDist.clear();
 	    model->getStateDistribution(curS, action, nextSDist);
 	    for (auto d : nextSDist) {
 	       nextSPred.push_back({d.mean, d.var});
@@ -407,7 +442,8 @@ void QLearner::oneStepUncRollout(const Trajectory& traj,
 	    DOUT << "Model rwd: N(" << rDist.mean << "," << rDist.var << ")" << endl;
 	    DOUT << "Model next term: N(" << nextTermDist.mean << "," << nextTermDist.var << ")" << endl;	    
 	 } else { // Bounds
-	    StateBound nextSBound;	    
+	    StateBound& nextSBound = workspace_.nextSBound;
+	    nextSBound.clear();
 	    model->getStateBounds(curS, action, nextS, nextSBound);
 	    nextSPred.clear();
 	    for (size_t i = 0; i < nextSBound.size(); ++i) {
@@ -448,7 +484,7 @@ void QLearner::oneStepUncRollout(const Trajectory& traj,
 	 nextTermPred = {1, 0};
       }
 
-      states.push_back(nextS);
+      measurements.addState(states) = nextS;
       rewards.push_back(rPred.pred);
       terms.push_back(nextTermPred.pred);
 
@@ -468,7 +504,7 @@ void QLearner::oneStepUncRollout(const Trajectory& traj,
       uncertainties.push_back(uncertainty);
 
       // increment s
-      curS = nextS;
+      swap(curS, nextS);
       action = nextAct;
 
       terminated = terminated or nextTerm;
@@ -484,7 +520,8 @@ void QLearner::targetRangeSMVEUpdate(const Trajectory& traj,
 				     PredictionModel* env,
 				     BBIPredictionModel* uncertainEnv,
 				     Measurements& measurements) {
-   size_t horizon = params_.getInt("horizon");
+   TRACE_SCOPE("targetRangeSMVEUpdate");
+   size_t horizon = config_.horizon;
 
    if (traj.getResultGameOver(t)) { // Episode has terminated so we can just update and leave.
       qUpdate(traj, t);
@@ -499,7 +536,8 @@ void QLearner::targetRangeSMVEUpdate(const Trajectory& traj,
    rlfloat_t predictedQ = qFunc_->getQ(traj.getPremiseState(t), traj.getAction(t));      
 
    // Target ranges
-   vector<Bound> targetBounds;
+   vector<Bound>& targetBounds = workspace_.targetBounds;
+   targetBounds.clear();
    bbiRollout(traj, t, horizon, model, targetBounds);
    getTargetRanges(targetBounds, predictedQ, measurements.targets, measurements.uncertainties);
    uncertaintiesToWeights(measurements.uncertainties, measurements.weights);
@@ -516,14 +554,14 @@ void QLearner::targetRangeSMVEUpdate(const Trajectory& traj,
    }
    DOUT << endl;
 
-   if (env != nullptr) {
+   if (env != nullptr and measurements.measureErrors) {
       RNG curRNG = rng_; 
       rng_ = copyRNG;      // Reset the RNG so random tie breaking is the same
       measurePredictionError(traj, t, env, measurements);
       rng_ = curRNG;       // Now put it back where it was after the original rollout
    }
 
-   if (uncertainEnv != nullptr) {
+   if (uncertainEnv != nullptr and measurements.measureErrors) {
       RNG curRNG = rng_; 
       rng_ = copyRNG;      // Reset the RNG so random tie breaking is the same
       measureBBIError(traj, t, uncertainEnv, measurements);
@@ -538,10 +576,12 @@ void QLearner::bbiRollout(const Trajectory& traj,
 			  size_t horizon,
 			  BBIPredictionModel* model,
 			  vector<Bound>& targetBounds) {
-   rlfloat_t discount = params_.getFloat("discount");
+   TRACE_SCOPE("bbiRollout");
+   rlfloat_t discount = config_.discount;
 
-   State curS = traj.getResultState(t);
-   StateBound curSBound;
+   const State& curS = traj.getResultState(t);
+   StateBound& curSBound = workspace_.curSBound;
+   curSBound.clear();
    for (auto d : curS) {
       curSBound.push_back({d, d});
    }
@@ -552,7 +592,9 @@ void QLearner::bbiRollout(const Trajectory& traj,
    rlfloat_t term = traj.getResultGameOver(t);
    Bound terminalBound{term, term};
 
-   vector<act_t> actSet;
+   vector<act_t>& actSet = workspace_.actSet;
+   vector<act_t>& nextActSet = workspace_.nextActSet;
+   StateBound& nextSBound = workspace_.nextSBound;
    Bound qBound = greedy(curSBound, actSet);
    targetBounds.push_back({cumR + discount*qBound.lower, cumR + discount*qBound.upper});
 
@@ -568,9 +610,8 @@ void QLearner::bbiRollout(const Trajectory& traj,
       Bound rBound{0, 0};
       Bound nextQBound{0, 0};
       Bound nextTermBound{1, 1};
-      vector<act_t> nextActSet;
-      
-      StateBound nextSBound;
+      nextActSet.clear();
+      nextSBound.clear();
       
       if (terminalBound.lower <= 0.5) {
 	 DOUT << "ActSet: ";
@@ -618,21 +659,23 @@ void QLearner::bbiRollout(const Trajectory& traj,
 
       targetBounds.push_back({returnMin, returnMax});
 
-      curSBound = nextSBound;
-      actSet = nextActSet;
+      swap(curSBound, nextSBound);
+      swap(actSet, nextActSet);
       
       terminalBound.lower = max(terminalBound.lower, nextTermBound.lower);
       terminalBound.upper = max(terminalBound.upper, nextTermBound.upper);
    }
 }
 
-Bound QLearner::greedy(const StateBound& stateBound, vector<act_t>& greedyActs) const {
-   vector<Bound> qBounds;
+Bound QLearner::greedy(const StateBound& stateBound, vector<act_t>& greedyActs) {
+   TRACE_SCOPE("greedyBound");
+   vector<Bound>& qBounds = workspace_.qBounds;
    qFunc_->getAllActQBounds(stateBound, qBounds);
    
    Bound greedyQBound {-numeric_limits<float>::infinity(), -numeric_limits<float>::infinity()};
    greedyActs.clear();
-   vector<Bound> greedyActBounds;
+   vector<Bound>& greedyActBounds = workspace_.greedyActBounds;
+   greedyActBounds.clear();
    
    for (act_t a = 0; a < numActions_; a++) {
       Bound qBound = qBounds[a];
@@ -682,9 +725,9 @@ void QLearner::getTargetRanges(const vector<Bound>& targetBounds,
 			       rlfloat_t predictedQ,
 			       const vector<rlfloat_t>& targets,
 			       vector<rlfloat_t>& uncertainties) {
-   bool directionalRange = params_.getInt("directional_range");
-   bool rejectOverlap = params_.getInt("reject_overlap");
-   rlfloat_t temperature = params_.getFloat("temperature");
+   bool directionalRange = config_.directionalRange;
+   bool rejectOverlap = config_.rejectOverlap;
+   rlfloat_t temperature = config_.temperature;
 
    for (size_t i = 0; i < targetBounds.size(); ++i) {
       if (temperature != numeric_limits<rlfloat_t>::infinity()) {
@@ -727,8 +770,9 @@ void QLearner::monteCarloSMVEUpdate(const Trajectory& traj,
 				    PredictionModel* env,
 				    BBIPredictionModel* uncertainEnv,
 				    Measurements& measurements) {
-   size_t horizon = params_.getInt("horizon");
-   bool useVariance = params_.getInt("use_variance");
+   TRACE_SCOPE("monteCarloSMVEUpdate");
+   size_t horizon = config_.horizon;
+   bool useVariance = config_.useVariance;
 
    if (traj.getResultGameOver(t)) { // Episode has terminated so we can just update and leave.
       qUpdate(traj, t);
@@ -737,15 +781,14 @@ void QLearner::monteCarloSMVEUpdate(const Trajectory& traj,
 
    RNG copyRNG = rng_;
    
-   vector<Population> targetPops;
-   monteCarloRollout(traj, t, horizon, model, targetPops, measurements);
+   monteCarloRollout(traj, t, horizon, model, particles_, measurements);
 
    if (useVariance) {
-      getMCTargetVariances(targetPops, measurements.targets, measurements.uncertainties);
+      getMCTargetVariances(particles_, measurements.targets, measurements.uncertainties);
    } else {
       // Current q estimate
       rlfloat_t predictedQ = qFunc_->getQ(traj.getPremiseState(t), traj.getAction(t));   
-      getMCTargetRanges(targetPops, predictedQ, measurements.targets, measurements.uncertainties);
+      getMCTargetRanges(particles_, predictedQ, measurements.targets, measurements.uncertainties);
    }
 
    uncertaintiesToWeights(measurements.uncertainties, measurements.weights);
@@ -762,14 +805,14 @@ void QLearner::monteCarloSMVEUpdate(const Trajectory& traj,
    }
    DOUT << endl;
 
-   if (env != nullptr) {
+   if (env != nullptr and measurements.measureErrors) {
       RNG curRNG = rng_; 
       rng_ = copyRNG;      // Reset the RNG so random tie breaking is the same
       measurePredictionError(traj, t, env, measurements);
       rng_ = curRNG;       // Now put it back where it was after the original rollout
    }
 
-   if (uncertainEnv != nullptr) {
+   if (uncertainEnv != nullptr and measurements.measureErrors) {
       RNG curRNG = rng_; 
       rng_ = copyRNG;      // Reset the RNG so random tie breaking is the same
       measureBBIError(traj, t, uncertainEnv, measurements);
@@ -783,143 +826,191 @@ void QLearner::monteCarloRollout(const Trajectory& traj,
 				 size_t t,
 				 size_t horizon,
 				 PredictionModel* model,
-				 vector<Population>& targetPops,
+				 ParticlePopulation& particles,
 				 Measurements& measurements) {
-   rlfloat_t discount = params_.getFloat("discount");
-   size_t numSamples = params_.getInt("num_samples");
+   TRACE_SCOPE("monteCarloRollout");
+   rlfloat_t discount = config_.discount;
+   size_t numSamples = config_.numSamples;
+
+   // Each sample draws from its own generator and the samples are combined in
+   // a fixed order, so the targets are the same however many threads there are
+   uint64_t rolloutKey = rng_.randomInt();
+   rolloutKey = (rolloutKey << 32) | rng_.randomInt();
+   vector<RNG>& sampleRNGs = workspace_.sampleRNGs;
+   sampleRNGs.clear();
+   for (size_t j = 0; j < numSamples; ++j) {
+      sampleRNGs.push_back(rng_.substream(rolloutKey, j));
+   }
+
+   const State& startState = traj.getResultState(t);
+   particles.resize(numSamples, startState.size(), horizon);
+   particles.fillStates(startState);
+   rlfloat_t* rPop = particles.getRewards();
+   rlfloat_t* tPop = particles.getTerms();
+   rlfloat_t* cumRPop = particles.getReturns();
+   act_t* actPop = particles.getActions();
+   unsigned char* alivePop = particles.getAlive();
 
    vector<State>& states = measurements.states;
-   states.clear();
-   StatePop curSPop(numSamples, traj.getResultState(t));
-   states.push_back(curSPop[0]);
+   measurements.clearStates(states);
+   measurements.addState(states) = startState;
 
    vector<rlfloat_t>& rewards = measurements.rewards;
    rewards.clear();
-   Population cumRPop(numSamples, traj.getReward(t));
-   rewards.push_back(cumRPop[0]);
+   fill(cumRPop, cumRPop + numSamples, traj.getReward(t));
+   rewards.push_back(traj.getReward(t));
    
    vector<rlfloat_t>& terms = measurements.terms;
    terms.clear();
    rlfloat_t term = traj.getResultGameOver(t);
    terms.push_back(term);
-   vector<unsigned char> termPop(numSamples, term >= 0.5);
+   fill(alivePop, alivePop + numSamples, term < 0.5);
 
    vector<rlfloat_t>& targets = measurements.targets;
    targets.clear();
-   targetPops.clear();   
-   auto [a, q] = greedy(curSPop[0]);   
-   targetPops.push_back(Population(numSamples, cumRPop.back() + discount*q));
-   targets.push_back(targetPops.back()[0]);
+   auto [a, q] = greedy(startState);   
+   fill(particles.getTargets(0), particles.getTargets(0) + numSamples, traj.getReward(t) + discount*q);
+   targets.push_back(traj.getReward(t) + discount*q);
 
    // In case of random tie-breaking between actions
-   vector<act_t> actPop;
    for (size_t i = 0; i < numSamples; ++i) {
-      tie(a, q) = greedy(curSPop[i]);
-      actPop.push_back(a);
+      tie(a, q) = greedy(*qFunc_, numActions_, sampleRNGs[i], startState);
+      actPop[i] = a;
+   }
+
+   // The population is split into one stretch per thread (or just one, if
+   // the model must be sampled from one thread at a time), and each stretch
+   // asks the model about all its samples that are still going at once
+   size_t numBatches = 1;
+   if (model->canSampleConcurrently()) {
+      numBatches = max(size_t(1), min(rolloutPool_->getNumThreads(), numSamples));
    }
+   sampleBatches_.resize(numBatches);
 
    rlfloat_t totalDiscount = discount;   
    for (size_t i = 1; i < horizon; ++i) {
       DOUT << "Rollout " << i << endl;
-      targets.push_back(0);
-      targetPops.push_back(Population(numSamples, 0));
-      Population rPop(numSamples, 0);
-      Population tPop(numSamples, 0);
-      StatePop sPop(numSamples);
+      rlfloat_t* targetPop = particles.getTargets(i);
 
       DOUT << "numSamples: " << numSamples << endl;
-      for (size_t j = 0; j < numSamples; ++j) {
-	 DOUT << "MC Rollout " << i << " Sample " << j << endl;
-	 DOUT << "curS: ";
-	 for (auto d : curSPop[j]) {
-	    DOUT << d << " ";
+      // Each batch only touches its own samples' entries
+      auto batchStep = [&](size_t b) {
+	 SampleBatch& batch = sampleBatches_[b];
+	 size_t begin = b*numSamples/numBatches;
+	 size_t end = (b + 1)*numSamples/numBatches;
+
+	 batch.ids.clear();
+	 batch.actions.clear();
+	 batch.rngs.clear();
+	 for (size_t j = begin; j < end; ++j) {
+	    if (alivePop[j]) {
+	       batch.ids.push_back(j);
+	       batch.actions.push_back(actPop[j]);
+	       batch.rngs.push_back(&sampleRNGs[j]);
+	    }
+	 }
+	 batch.premises.resize(batch.ids.size());
+	 for (size_t k = 0; k < batch.ids.size(); ++k) {
+	    particles.getState(batch.ids[k], batch.premises[k]);
 	 }
-	 DOUT << endl;
 
-	 rlfloat_t nextQ = 0;
-	 act_t nextAct = 0;
+	 model->getStatePredSampleBatch(batch.premises, batch.actions, batch.samples, batch.rngs);
+	 model->getRewardPredSampleBatch(batch.premises, batch.actions, batch.rewards, batch.rngs);
+	 model->getTermPredSampleBatch(batch.premises, batch.actions, batch.terms, batch.rngs);
 
-	 if (!termPop[j]) {
-	    model->getStatePredSample(curSPop[j], actPop[j], sPop[j]);
-	    DOUT << "Next s: ";
-	    for (size_t d = 0; d < sPop[j].size(); ++d) {
-	       DOUT << sPop[j][d] << " ";
-	    }
-	    DOUT << endl;
-	    rPop[j] = model->getRewardPredSample(curSPop[j], actPop[j]);
-	    tPop[j] = model->getTermPredSample(curSPop[j], actPop[j]);
+	 size_t k = 0;
+	 for (size_t j = begin; j < end; ++j) {
+	    DOUT << "MC Rollout " << i << " Sample " << j << endl;
 
-	    DOUT << "Predicted r: " << rPop[j] << endl;
-	    DOUT << "Predicted term: " << tPop[j] << endl;
-	    
-	    if (tPop[j] < 0.5) {	 
-	       tie(nextAct, nextQ) = greedy(sPop[j]);
+	    rlfloat_t nextQ = 0;
+	    act_t nextAct = 0;
+
+	    if (alivePop[j]) {
+	       rPop[j] = batch.rewards[k];
+	       tPop[j] = batch.terms[k];
+
+	       DOUT << "Predicted r: " << rPop[j] << endl;
+	       DOUT << "Predicted term: " << tPop[j] << endl;
+
+	       if (tPop[j] < 0.5) {	 
+		  tie(nextAct, nextQ) = greedy(*qFunc_, numActions_, sampleRNGs[j], batch.samples[k]);
+	       }
+	       ++k;
+	    } else {
+	       rPop[j] = 0;
+	       tPop[j] = 1;
 	    }
-	 } else {
-	    sPop[j] = curSPop[j];
-	    tPop[j] = 1;
-	 }
 
-	 cumRPop[j] += totalDiscount*rPop[j];
-      	 targetPops[i][j] = cumRPop[j] + totalDiscount*discount*nextQ;
-	 targets.back() += targetPops[i][j]/numSamples;
-      
-	 DOUT << "cumR: " << cumRPop[j] << " nextQ: " << nextQ << " target: " << targetPops[i][j] << endl;
+	    cumRPop[j] += totalDiscount*rPop[j];
+	    targetPop[j] = cumRPop[j] + totalDiscount*discount*nextQ;
 
-	 curSPop[j] = sPop[j];
-	 actPop[j] = nextAct;
-	 termPop[j] = termPop[j] or (tPop[j] >= 0.5);
-      }
+	    DOUT << "cumR: " << cumRPop[j] << " nextQ: " << nextQ << " target: " << targetPop[j] << endl;
 
-      State s(sPop[0].size(), 0);
-      rlfloat_t r = 0;
-      rlfloat_t t = 0;
-      for (unsigned j = 0; j < numSamples; ++j) {
-	 for (unsigned d = 0; d < s.size(); ++d) {
-	    s[d] += sPop[j][d]/numSamples;
+	    actPop[j] = nextAct;
+	    alivePop[j] = alivePop[j] and (tPop[j] < 0.5);
+	 }
+      };
+      // By reference, since a std::function holding the lambda itself would
+      // allocate every step
+      rolloutPool_->run(numBatches, ref(batchStep));
+
+      // A model's states need not be the size of the observed ones (part of
+      // the state can be hidden from it), so the first prediction sets the
+      // size; samples that had already ended keep their states
+      size_t nextStateDim = particles.getStateDim();
+      for (const auto& batch : sampleBatches_) {
+	 if (!batch.samples.empty()) {
+	    nextStateDim = batch.samples[0].size();
+	    break;
 	 }
-	 r += rPop[j]/numSamples;
-	 t += tPop[j]/numSamples;
       }
-      states.push_back(s);
-      rewards.push_back(r);
-      terms.push_back(t);
+      particles.setNextStateDim(nextStateDim);
+      for (size_t b = 0; b < numBatches; ++b) {
+	 const SampleBatch& batch = sampleBatches_[b];
+	 size_t k = 0;
+	 for (size_t j = b*numSamples/numBatches; j < (b + 1)*numSamples/numBatches; ++j) {
+	    if (k < batch.ids.size() and batch.ids[k] == j) {
+	       particles.setNextState(j, batch.samples[k]);
+	       ++k;
+	    } else {
+	       particles.keepState(j);
+	    }
+	 }
+      }
+      particles.advance();
+
+      targets.push_back(ParticlePopulation::sum(targetPop, numSamples)/numSamples);
+      particles.getMeanState(measurements.addState(states));
+      rewards.push_back(ParticlePopulation::sum(rPop, numSamples)/numSamples);
+      terms.push_back(ParticlePopulation::sum(tPop, numSamples)/numSamples);
       
       totalDiscount *= discount;
    }   
 }
 
-void QLearner::getMCTargetRanges(const vector<Population>& targetPop,
+void QLearner::getMCTargetRanges(const ParticlePopulation& particles,
 				 rlfloat_t predictedQ,
-				 const vector<rlfloat_t> targets,
+				 const vector<rlfloat_t>& targets,
 				 vector<rlfloat_t>& uncertainties) {
-   vector<Bound> targetBounds;
-   for (size_t i = 0; i < targetPop.size(); ++i) {
-      rlfloat_t maxTarget = targetPop[i][0];
-      rlfloat_t minTarget = targetPop[i][0];
-      for (size_t j = 1; j < targetPop[i].size(); ++j) {
-	 maxTarget = max(maxTarget, targetPop[i][j]);
-	 minTarget = min(minTarget, targetPop[i][j]);
-      }
-      targetBounds.push_back({minTarget, maxTarget});
+   vector<Bound>& targetBounds = workspace_.targetBounds;
+   targetBounds.clear();
+   for (size_t i = 0; i < particles.getHorizon(); ++i) {
+      targetBounds.push_back(ParticlePopulation::getRange(particles.getTargets(i), particles.getNumSamples()));
    }
    getTargetRanges(targetBounds, predictedQ, targets, uncertainties);
 }
 
-void QLearner::getMCTargetVariances(const vector<Population>& targetPops,
-				    const vector<rlfloat_t> targets,
+void QLearner::getMCTargetVariances(const ParticlePopulation& particles,
+				    const vector<rlfloat_t>& targets,
 				    vector<rlfloat_t>& uncertainties) {
-   size_t numSamples = params_.getInt("num_samples");
-   rlfloat_t temperature = params_.getFloat("temperature");
+   size_t numSamples = config_.numSamples;
+   rlfloat_t temperature = config_.temperature;
 
-   for (size_t i = 0; i < targetPops.size(); ++i) {
+   for (size_t i = 0; i < particles.getHorizon(); ++i) {
       if (numSamples <= 0 or temperature == numeric_limits<rlfloat_t>::infinity()) {
 	 uncertainties.push_back(0);
       } else {
-	 rlfloat_t uncertainty = 0;
-	 for (size_t j = 0; j < targetPops[i].size(); ++j) {
-	    uncertainty += (targetPops[i][j] - targets[i])*(targetPops[i][j] - targets[i]);	       
-	 }
+	 rlfloat_t uncertainty = ParticlePopulation::sumSquaredDiff(particles.getTargets(i), numSamples, targets[i]);
 	 uncertainty /= numSamples - 1;
 	 uncertainties.push_back(uncertainty);
       }
@@ -933,16 +1024,19 @@ void QLearner::measurePredictionError(const Trajectory& traj,
 				      size_t t,
 				      PredictionModel* env,
 				      Measurements& measurements) {
-   size_t horizon = params_.getInt("horizon");
+   TRACE_SCOPE("measurePredictionError");
+   ALLOC_PHASE(AllocStats::measure);
+   size_t horizon = config_.horizon;
 
-   Measurements envMeasurements;
+   Measurements& envMeasurements = workspace_.envMeasurements;
+   envMeasurements.clear();
    expectationRollout(traj, t, horizon, env, envMeasurements);
    
    for (size_t i = 0; i < envMeasurements.states.size(); ++i) {
-      measurements.stateError.push_back(vector<rlfloat_t>());
+      State& stateError = measurements.addState(measurements.stateError);
+      stateError.clear();
       for (size_t j = 0; j < measurements.states[i].size(); ++j) {
-	 measurements.stateError.back().push_back(envMeasurements.states[i][j] -
-						  measurements.states[i][j]);
+	 stateError.push_back(envMeasurements.states[i][j] - measurements.states[i][j]);
       }
       measurements.rwdError.push_back(envMeasurements.rewards[i] - measurements.rewards[i]);
       measurements.termError.push_back(envMeasurements.terms[i] - measurements.terms[i]);      
@@ -954,17 +1048,22 @@ void QLearner::measureBBIError(const Trajectory& traj,
 			       size_t t,
 			       BBIPredictionModel* uncertainEnv,
 			       Measurements& measurements) {
-   size_t horizon = params_.getInt("horizon");
+   TRACE_SCOPE("measureBBIError");
+   ALLOC_PHASE(AllocStats::measure);
+   size_t horizon = config_.horizon;
    
    // Now get targets using the uncertain oracle
-   Measurements uncMeasurements;
+   Measurements& uncMeasurements = workspace_.envMeasurements;
+   uncMeasurements.clear();
    expectationRollout(traj, t, horizon, uncertainEnv, uncMeasurements);
    
-   vector<Bound> uncTargetBounds;
+   vector<Bound>& uncTargetBounds = workspace_.targetBounds;
+   uncTargetBounds.clear();
    bbiRollout(traj, t, horizon, uncertainEnv, uncTargetBounds);
    
    rlfloat_t predictedQ = qFunc_->getQ(traj.getPremiseState(t), traj.getAction(t));      
-   vector<rlfloat_t> uncUncertainties;
+   vector<rlfloat_t>& uncUncertainties = workspace_.uncUncertainties;
+   uncUncertainties.clear();
    getTargetRanges(uncTargetBounds, predictedQ, uncMeasurements.targets, uncUncertainties);
    
    for (size_t i = 0; i < uncUncertainties.size(); ++i) {
@@ -976,3 +1075,47 @@ void QLearner::measureBBIError(const Trajectory& traj,
       }
    }
 }
+
+///////////////////////////////
+// Measurements              //
+///////////////////////////////
+void QLearner::Measurements::clear() {
+   clearStates(states);
+   rewards.clear();
+   terms.clear();
+   targets.clear();
+   uncertainties.clear();
+   weights.clear();
+   clearStates(stateError);
+   rwdError.clear();
+   termError.clear();
+   targetError.clear();
+   uncertaintyError.clear();
+}
+
+void QLearner::Measurements::clearStates(vector<State>& v) {
+   for (auto& s : v) {
+      spareStates.push_back(move(s));
+   }
+   v.clear();
+}
+
+State& QLearner::Measurements::addState(vector<State>& v) {
+   if (spareStates.empty()) {
+      v.emplace_back();
+   } else {
+      v.push_back(move(spareStates.back()));
+      spareStates.pop_back();
+   }
+   return v.back();
+}
+
+void QLearner::save(CheckpointWriter& out) const {
+   out.write(rng_);
+   qFunc_->save(out);
+}
+
+void QLearner::load(CheckpointReader& in) {
+   in.read(rng_);
+   qFunc_->load(in);
+}
@@ -4,9 +4,11 @@
 #include "Trajectory.hpp"
 #include "QFunction.hpp"
 #include "PredictionModel.hpp"
-#include "Params.hpp"
+#include "Config.hpp"
 #include "RNG.hpp"
 #include "RLTypes.hpp"
+#include "ThreadPool.hpp"
+#include "ParticlePopulation.hpp"
 
 #include <unordered_map>
 #include <vector>
@@ -30,9 +32,26 @@ class QLearner
       std::vector<rlfloat_t> termError;
       std::vector<rlfloat_t> targetError;
       std::vector<rlfloat_t> uncertaintyError;
+
+      // Whether to fill in the errors above, which takes rollouts of its own
+      // in the true environment and the oracle
+      bool measureErrors = true;
+
+      // Empties the vectors (leaving measureErrors as it is) but keeps their
+      // storage, and that of the states in them, so that one Measurements can
+      // be refilled every frame without allocating
+      void clear();
+      // Empties states or stateError, keeping the states' storage
+      void clearStates(std::vector<State>& v);
+      // Appends a state to states or stateError, reusing the storage of one
+      // emptied earlier if there is one
+      State& addState(std::vector<State>& v);
+
+      // The states emptied so far, not yet reused
+      std::vector<State> spareStates;
    };
 
-   QLearner(QFunction* qFunc, act_t numActions, RNG& rng, const Params& params);
+   QLearner(QFunction* qFunc, act_t numActions, RNG& rng, const Config& config);
    virtual ~QLearner();
 
    virtual void qUpdate(const Trajectory& traj, std::size_t t);   
@@ -91,6 +110,13 @@ class QLearner
    virtual act_t getGreedyAction(const State& s) const;
    virtual act_t getGreedyAction(const State& s, rlfloat_t& qVal) const;   
 
+   // Greedy action (ties broken at random) and its value under any Q-function
+   static std::tuple<act_t, rlfloat_t> greedy(const QFunction& qFunc, act_t numActions, RNG& rng, const State& state);
+
+   // Includes the Q-function
+   virtual void save(CheckpointWriter& out) const;
+   virtual void load(CheckpointReader& in);
+
   protected:
    virtual void weightedAvgUpdate(const Trajectory &traj,
 				  const std::size_t t,
@@ -98,7 +124,7 @@ class QLearner
 				  const std::vector<rlfloat_t>& weights);
    
    std::tuple<act_t, rlfloat_t> greedy(const State& state) const;
-   Bound greedy(const StateBound& stateBound, std::vector<act_t>& greedyActs) const;
+   Bound greedy(const StateBound& stateBound, std::vector<act_t>& greedyActs);
 
    void expectationRollout(const Trajectory& traj,
 			   std::size_t t,
@@ -126,14 +152,14 @@ class QLearner
 			  std::size_t t,
 			  std::size_t horizon,
 			  PredictionModel* model,
-			  std::vector<Population>& targetPops,
+			  ParticlePopulation& particles,
 			  Measurements& measurements);
-   void getMCTargetRanges(const std::vector<Population>& targetPop,
+   void getMCTargetRanges(const ParticlePopulation& particles,
 			  rlfloat_t predictedQ,
-			  const std::vector<rlfloat_t> targets,
+			  const std::vector<rlfloat_t>& targets,
 			  std::vector<rlfloat_t>& uncertainties);
-   void getMCTargetVariances(const std::vector<Population>& targetPop,
-			     const std::vector<rlfloat_t> targets,
+   void getMCTargetVariances(const ParticlePopulation& particles,
+			     const std::vector<rlfloat_t>& targets,
 			     std::vector<rlfloat_t>& uncertainties);
 
    void measurePredictionError(const Trajectory& traj,
@@ -152,7 +178,44 @@ class QLearner
    rlfloat_t initialStepsize_;
    act_t numActions_;
    mutable RNG rng_;
-   const Params& params_;
+   const Config config_;
+   // Spreads the samples of Monte Carlo rollouts over rollout_threads threads
+   ThreadPool* rolloutPool_;
+   // The samples of the latest Monte Carlo rollout, kept to reuse their arrays
+   ParticlePopulation particles_;
+   // A stretch of the population's samples that are still going, gathered
+   // to be passed to the model in one batch
+   struct SampleBatch {
+      std::vector<std::size_t> ids;
+      std::vector<State> premises;
+      std::vector<act_t> actions;
+      std::vector<RNG*> rngs;
+      std::vector<State> samples;
+      std::vector<rlfloat_t> rewards;
+      std::vector<rlfloat_t> terms;
+   };
+   // One per rollout thread
+   std::vector<SampleBatch> sampleBatches_;
+   // What the rollouts work in, kept from frame to frame so that once the
+   // buffers have grown to size the updates allocate nothing of their own
+   struct RolloutWorkspace {
+      State curS;
+      State nextS;
+      StateNormal nextSDist;
+      StateBound nextSBound;
+      StatePredUnc nextSPred;
+      StateBound curSBound;
+      std::vector<act_t> actSet;
+      std::vector<act_t> nextActSet;
+      std::vector<Bound> targetBounds;
+      std::vector<Bound> qBounds;
+      std::vector<Bound> greedyActBounds;
+      std::vector<rlfloat_t> uncUncertainties;
+      std::vector<RNG> sampleRNGs;
+      // The error measurements' own rollouts
+      Measurements envMeasurements;
+   };
+   RolloutWorkspace workspace_;
 };
 
 #endif
@@ -27,7 +27,4 @@ struct PredUnc {
 };
 using StatePredUnc = std::vector<PredUnc>;
 
-using Population = std::vector<rlfloat_t>;
-using StatePop = std::vector<State>;
-
 #endif
@@ -53,6 +53,15 @@ TileCodingQFunction::GridWeightManager::GridWeightManager(const vector<size_t>&
    }
 }
 
+TileCodingQFunction::GridWeightManager::GridWeightManager(const GridWeightManager& other) :
+   weights_{other.weights_},
+   numDivisions_{other.numDivisions_},
+   numActions_{other.numActions_} {
+   for (auto r : other.trieRoots_) {
+      trieRoots_.push_back(r->copy());
+   }
+}
+
 TileCodingQFunction::GridWeightManager::~GridWeightManager() {
    for (auto r : trieRoots_) {
       delete r;
@@ -67,8 +76,23 @@ TileCodingQFunction::GridWeightManager::TrieNode::~TrieNode() {
    }
 }
 
+TileCodingQFunction::GridWeightManager::TrieNode* TileCodingQFunction::GridWeightManager::TrieNode::copy() const {
+   TrieNode* n = new TrieNode;
+   n->index = index;
+   for (auto c : children) {
+      n->children.push_back(c ? c->copy() : nullptr);
+   }
+   return n;
+}
+
+QFunction* TileCodingQFunction::clone() const {
+   return new TileCodingQFunction(*this);
+}
+
 float TileCodingQFunction::getQ(const State& state, act_t action) const {
-   vector<vector<size_t> > coords;
+   // Kept per thread so that a lookup allocates nothing once it has grown to
+   // size (several threads can look up at once)
+   static thread_local vector<vector<size_t> > coords;
    getCoordinates(state, coords);
    DOUT << "Getting Q: ";
    for (auto& c : coords) {
@@ -83,7 +107,7 @@ float TileCodingQFunction::getQ(const State& state, act_t action) const {
 }
 
 void TileCodingQFunction::getAllActQs(const State& state, vector<float>& qVals) const {
-   vector<vector<size_t> > coords;
+   static thread_local vector<vector<size_t> > coords;
    getCoordinates(state, coords);
    DOUT << "Getting All Qs: ";
    for (auto& c : coords) {
@@ -146,13 +170,13 @@ size_t TileCodingQFunction::GridWeightManager::getIndex(const vector<size_t>& co
 }
 
 Bound TileCodingQFunction::getQBound(const StateBound& stateBound, act_t action) const {
-   vector<CoordBound > bounds;
+   static thread_local vector<CoordBound > bounds;
    getBounds(stateBound, bounds);
    return weights_.getQBound(bounds, action);
 }
 
 void TileCodingQFunction::getAllActQBounds(const StateBound& stateBound, vector<Bound>& qBounds) const {
-   vector<CoordBound > bounds;
+   static thread_local vector<CoordBound > bounds;
    getBounds(stateBound, bounds);
    weights_.getAllActQBounds(bounds, qBounds);
 }
@@ -221,12 +245,12 @@ Bound TileCodingQFunction::GridWeightManager::getQBound(const vector<CoordBound
 void TileCodingQFunction::GridWeightManager::getAllActQBounds(const vector<CoordBound >& bounds, vector<Bound>& qBounds) const {
    qBounds.clear();
    qBounds.resize(numActions_, {0, 0});
-   vector<size_t> coord (bounds[0].size());
+   static thread_local vector<Bound> wrs;
    for (size_t i = 0; i < bounds.size(); ++i) {
       DOUT << "Getting all act bounds for tiling " << i << endl;
       const CoordBound& bound = bounds[i];
 
-      vector<Bound> wrs(numActions_, {numeric_limits<float>::infinity(), -numeric_limits<float>::infinity()});
+      wrs.assign(numActions_, {numeric_limits<float>::infinity(), -numeric_limits<float>::infinity()});
       TrieNode* n = trieRoots_[i];
       getWeightBounds(n, bound, 0, i, wrs);
       
@@ -265,11 +289,11 @@ void TileCodingQFunction::GridWeightManager::getWeightBounds(TrieNode* n, const
 }
    
 void TileCodingQFunction::updateQ(const State& state, act_t action, float change) {
-   vector<vector<size_t> > coords;
+   static thread_local vector<vector<size_t> > coords;
    getCoordinates(state, coords);
 
    DOUT << "Updating ";
-   for (auto c : coords) {
+   for (auto& c : coords) {
       DOUT << "(";
       for (auto x : c) {
 	 DOUT << x << " ";
@@ -308,3 +332,79 @@ void TileCodingQFunction::GridWeightManager::updateQ(const vector<vector<size_t>
 float TileCodingQFunction::getStepSizeNormalizer() const {
    return offsets_.size(); // Number of tilings
 }
+
+void TileCodingQFunction::addFootprint(Footprint& footprint) const {
+   weights_.addFootprint(footprint);
+}
+
+void TileCodingQFunction::save(CheckpointWriter& out) const {
+   weights_.save(out);
+}
+
+void TileCodingQFunction::load(CheckpointReader& in) {
+   weights_.load(in);
+}
+
+void TileCodingQFunction::GridWeightManager::addFootprint(Footprint& footprint) const {
+   // The weights are all allocated up front; only the trie grows
+   size_t weightBytes = Footprint::heapBytes(weights_);
+   for (auto& ws : weights_) {
+      weightBytes += Footprint::heapBytes(ws);
+   }
+   footprint.add(Footprint::qFunction, 0, weightBytes);
+   for (auto r : trieRoots_) {
+      r->addFootprint(footprint);
+   }
+}
+
+void TileCodingQFunction::GridWeightManager::TrieNode::addFootprint(Footprint& footprint) const {
+   footprint.add(Footprint::qFunction, 1, sizeof(TrieNode) + Footprint::heapBytes(children));
+   for (auto c : children) {
+      if (c) {
+	 c->addFootprint(footprint);
+      }
+   }
+}
+
+void TileCodingQFunction::GridWeightManager::save(CheckpointWriter& out) const {
+   out.write(weights_);
+   // The trie marks every weight that was ever touched, even if it has since returned to 0
+   for (auto r : trieRoots_) {
+      r->save(out);
+   }
+}
+
+void TileCodingQFunction::GridWeightManager::load(CheckpointReader& in) {
+   in.read(weights_);
+   for (auto& r : trieRoots_) {
+      delete r;
+      r = new TrieNode;
+      r->load(in);
+   }
+}
+
+void TileCodingQFunction::GridWeightManager::TrieNode::save(CheckpointWriter& out) const {
+   out.write(index);
+   out.write(children.size());
+   for (auto c : children) {
+      out.write(static_cast<unsigned char>(c != nullptr));
+      if (c) {
+	 c->save(out);
+      }
+   }
+}
+
+void TileCodingQFunction::GridWeightManager::TrieNode::load(CheckpointReader& in) {
+   in.read(index);
+   size_t numChildren;
+   in.read(numChildren);
+   children.resize(numChildren, nullptr);
+   for (auto& c : children) {
+      unsigned char present;
+      in.read(present);
+      if (present) {
+	 c = new TrieNode;
+	 c->load(in);
+      }
+   }
+}
@@ -21,6 +21,13 @@ class TileCodingQFunction : public QFunction {
    virtual void updateQ(const State& state, act_t action, float change);
    virtual float getStepSizeNormalizer() const;
 
+   virtual QFunction* clone() const;
+
+   virtual void addFootprint(Footprint& footprint) const;
+
+   virtual void save(CheckpointWriter& out) const;
+   virtual void load(CheckpointReader& in);
+
   protected:
    struct IdxBound {
       size_t lower;
@@ -39,17 +46,26 @@ class TileCodingQFunction : public QFunction {
    class GridWeightManager {
      public:
       GridWeightManager(const std::vector<size_t>& numDivisions, size_t numTilings, act_t numActions);
+      GridWeightManager(const GridWeightManager& other);
+      GridWeightManager& operator=(const GridWeightManager&) = delete;
       ~GridWeightManager();
       float getQ(const std::vector<std::vector<size_t> >& coords, act_t action) const;
       void getAllActQs(const std::vector<std::vector<size_t> >& coords, std::vector<float>& qVals) const;
       Bound getQBound(const std::vector<CoordBound>& bounds, act_t action) const;
       void getAllActQBounds(const std::vector<CoordBound>& bounds, std::vector<Bound>& qBounds) const;      
       void updateQ(const std::vector<std::vector<size_t> >& coords, act_t action, float change);
+      void addFootprint(Footprint& footprint) const;
+      void save(CheckpointWriter& out) const;
+      void load(CheckpointReader& in);
      private:
       struct TrieNode {
 	 ~TrieNode();
+	 TrieNode* copy() const;
+	 void addFootprint(Footprint& footprint) const;
+	 void save(CheckpointWriter& out) const;
+	 void load(CheckpointReader& in);
 	 std::vector<TrieNode*> children;
-	 size_t index;
+	 size_t index = 0;
       };
       
       size_t getIndex(const std::vector<size_t>& coord, size_t tiling) const;
@@ -75,3 +75,32 @@ void Trajectory::shrinkToFit()
    rewardData.shrink_to_fit();
    gameOverData.shrink_to_fit();
 }
+
+void Trajectory::addFootprint(Footprint& footprint) const
+{
+   size_t bytes = sizeof(Trajectory) +
+      Footprint::heapBytes(obsData) +
+      Footprint::heapBytes(actionData) +
+      Footprint::heapBytes(rewardData) +
+      Footprint::heapBytes(gameOverData);
+   for (auto& s : obsData) {
+      bytes += Footprint::heapBytes(s);
+   }
+   footprint.add(Footprint::trajectories, getSize(), bytes);
+}
+
+void Trajectory::save(CheckpointWriter& out) const
+{
+   out.write(obsData);
+   out.write(actionData);
+   out.write(rewardData);
+   out.write(gameOverData);
+}
+
+void Trajectory::load(CheckpointReader& in)
+{
+   in.read(obsData);
+   in.read(actionData);
+   in.read(rewardData);
+   in.read(gameOverData);
+}
@@ -2,6 +2,8 @@
 #define TRAJECTORY
 
 #include "RLTypes.hpp"
+#include "Checkpoint.hpp"
+#include "Footprint.hpp"
 
 #include <vector>
 
@@ -28,6 +30,10 @@ class Trajectory
    virtual const State& getCurState() const;
    virtual act_t getCurPrevAction() const;
    virtual void shrinkToFit();
+   virtual void addFootprint(Footprint& footprint) const;
+
+   virtual void save(CheckpointWriter& out) const;
+   virtual void load(CheckpointReader& in);
 };
 
 #endif
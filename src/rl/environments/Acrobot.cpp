@@ -79,7 +79,7 @@ void Acrobot::getStateBounds(const State& premise, size_t action, State& predict
    }
 }
 
-void Acrobot::getStatePredSample(const State& premise, size_t action, State& predictions) const {
+void Acrobot::getStatePredSample(const State& premise, size_t action, State& predictions, RNG&) const {
    getStatePrediction(premise, action, predictions);
 }
 
@@ -93,7 +93,7 @@ rlfloat_t Acrobot::getRewardBounds(const State& premise, size_t action, Bound& r
    return rwd;
 }
 
-rlfloat_t Acrobot::getRewardPredSample(const State& premise, size_t action) const {
+rlfloat_t Acrobot::getRewardPredSample(const State& premise, size_t action, RNG&) const {
    return getRewardPrediction(premise, action);
 }
 
@@ -111,10 +111,43 @@ rlfloat_t Acrobot::getTermBounds(const State& premise, size_t action, Bound& ter
    return term;
 }
 
-bool Acrobot::getTermPredSample(const State& premise, size_t action) const {
+bool Acrobot::getTermPredSample(const State& premise, size_t action, RNG&) const {
    return getTermPrediction(premise, action);
 }
 
+void Acrobot::getStatePredictionBatch(const vector<State>& premises, const vector<act_t>& actions, vector<State>& predictedStates) const {
+   predictedStates.resize(premises.size());
+   for (size_t k = 0; k < premises.size(); ++k) {
+      Acrobot::getStatePrediction(premises[k], actions[k], predictedStates[k]);
+   }
+}
+
+void Acrobot::getRewardPredictionBatch(const vector<State>& premises, const vector<act_t>&, vector<rlfloat_t>& rewards) const {
+   rewards.assign(premises.size(), -1);
+}
+
+void Acrobot::getTermPredictionBatch(const vector<State>& premises, const vector<act_t>& actions, vector<rlfloat_t>& terms) const {
+   terms.resize(premises.size());
+   State nextState;
+   for (size_t k = 0; k < premises.size(); ++k) {
+      Acrobot::getStatePrediction(premises[k], actions[k], nextState);
+      bool terminates = (-cos(nextState[0]) - cos(nextState[1]+nextState[0])) > 1.0;
+      terms[k] = terminates ? 1.0 : 0.0;
+   }
+}
+
+void Acrobot::getStatePredSampleBatch(const vector<State>& premises, const vector<act_t>& actions, vector<State>& samples, const vector<RNG*>&) const {
+   Acrobot::getStatePredictionBatch(premises, actions, samples);
+}
+
+void Acrobot::getRewardPredSampleBatch(const vector<State>& premises, const vector<act_t>& actions, vector<rlfloat_t>& rewards, const vector<RNG*>&) const {
+   Acrobot::getRewardPredictionBatch(premises, actions, rewards);
+}
+
+void Acrobot::getTermPredSampleBatch(const vector<State>& premises, const vector<act_t>& actions, vector<rlfloat_t>& terms, const vector<RNG*>&) const {
+   Acrobot::getTermPredictionBatch(premises, actions, terms);
+}
+
 // Multiply a vector by a scalar
 State Acrobot::scalarMult(const vector <rlfloat_t>& vec, const rlfloat_t sca) const{
    vector <rlfloat_t> newVec(5);
@@ -191,3 +224,11 @@ rlfloat_t Acrobot::wrap(rlfloat_t val, const rlfloat_t min, const rlfloat_t max)
    }
    return val;
 }
+
+void Acrobot::save(CheckpointWriter& out) const {
+   out.write(rng_);
+}
+
+void Acrobot::load(CheckpointReader& in) {
+   in.read(rng_);
+}
@@ -12,15 +12,29 @@ class Acrobot : public PredictionModel {
    
    virtual void getStatePrediction(const State& premise, act_t action, State& predictedState) const;
    virtual void getStateBounds(const State& premise, act_t action, State& predictedState, StateBound& predictedBounds) const;
-   virtual void getStatePredSample(const State& premise, act_t action, State& predictions) const;
+   virtual void getStatePredSample(const State& premise, act_t action, State& predictions, RNG& rng) const;
 
    virtual rlfloat_t getRewardPrediction(const State& premise, act_t action) const;
    virtual rlfloat_t getRewardBounds(const State& premise, act_t action, Bound& rewardBound) const;
-   virtual rlfloat_t getRewardPredSample(const State& premise, act_t action) const;
+   virtual rlfloat_t getRewardPredSample(const State& premise, act_t action, RNG& rng) const;
 
    virtual rlfloat_t getTermPrediction(const State& premise, act_t action) const;
    virtual rlfloat_t getTermBounds(const State& premise, act_t action, Bound& termBound) const;
-   virtual bool getTermPredSample(const State& premise, act_t action) const;
+   virtual bool getTermPredSample(const State& premise, act_t action, RNG& rng) const;
+
+   virtual void getStatePredictionBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<State>& predictedStates) const;
+   virtual void getRewardPredictionBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<rlfloat_t>& rewards) const;
+   virtual void getTermPredictionBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<rlfloat_t>& terms) const;
+   // Deterministic (apart from the distractor), so these are the predictions
+   virtual void getStatePredSampleBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<State>& samples, const std::vector<RNG*>& rngs) const;
+   virtual void getRewardPredSampleBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<rlfloat_t>& rewards, const std::vector<RNG*>& rngs) const;
+   virtual void getTermPredSampleBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<rlfloat_t>& terms, const std::vector<RNG*>& rngs) const;
+
+   // The distractor is drawn from the model's own generator
+   virtual bool canSampleConcurrently() const {return !distractor_;}
+
+   virtual void save(CheckpointWriter& out) const;
+   virtual void load(CheckpointReader& in);
 
   protected:
    virtual std::vector<rlfloat_t> dsdt(const State& state) const;
@@ -5,10 +5,10 @@
 
 using namespace std;
 
-GoRight::GoRight(const Params& params) :
-   numInd_(params.getInt("gor_num_ind")),
-   length_(params.getInt("gor_length")),
-   prizeMult_(params.getFloat("gor_prize_mult")),
+GoRight::GoRight(const Config& config) :
+   numInd_(config.gorNumInd),
+   length_(config.gorLength),
+   prizeMult_(config.gorPrizeMult),
    maxStat_(2),
    statScale_(rlfloat_t(length_)/maxStat_) {
 }
@@ -83,9 +83,6 @@ void GoRight::getStatePrediction(const State& premise, act_t action, State& pred
 }
 
 rlfloat_t GoRight::getRewardPrediction(const State& premise, act_t action) const {
-   State result;
-   getStatePrediction(premise, action, result);
-
    bool allOn = true;
    for (size_t i = 1; i <= numInd_; ++i) {
       allOn = allOn and (premise[i] > 0.5);
@@ -104,11 +101,41 @@ rlfloat_t GoRight::getTermPrediction(const State&, act_t) const {
    return 0;
 }
 
-GoRightUncertain::GoRightUncertain(RNG& rng, const Params& params) :
+void GoRight::getStatePredictionBatch(const vector<State>& premises, const vector<act_t>& actions, vector<State>& predictedStates) const {
+   predictedStates.resize(premises.size());
+   for (size_t k = 0; k < premises.size(); ++k) {
+      GoRight::getStatePrediction(premises[k], actions[k], predictedStates[k]);
+   }
+}
+
+void GoRight::getRewardPredictionBatch(const vector<State>& premises, const vector<act_t>& actions, vector<rlfloat_t>& rewards) const {
+   rewards.resize(premises.size());
+   for (size_t k = 0; k < premises.size(); ++k) {
+      rewards[k] = GoRight::getRewardPrediction(premises[k], actions[k]);
+   }
+}
+
+void GoRight::getTermPredictionBatch(const vector<State>& premises, const vector<act_t>&, vector<rlfloat_t>& terms) const {
+   terms.assign(premises.size(), 0);
+}
+
+void GoRight::getStatePredSampleBatch(const vector<State>& premises, const vector<act_t>& actions, vector<State>& samples, const vector<RNG*>&) const {
+   GoRight::getStatePredictionBatch(premises, actions, samples);
+}
+
+void GoRight::getRewardPredSampleBatch(const vector<State>& premises, const vector<act_t>& actions, vector<rlfloat_t>& rewards, const vector<RNG*>&) const {
+   GoRight::getRewardPredictionBatch(premises, actions, rewards);
+}
+
+void GoRight::getTermPredSampleBatch(const vector<State>& premises, const vector<act_t>& actions, vector<rlfloat_t>& terms, const vector<RNG*>&) const {
+   GoRight::getTermPredictionBatch(premises, actions, terms);
+}
+
+GoRightUncertain::GoRightUncertain(RNG& rng, const Config& config) :
    rng_(rng.randomInt()),
-   numInd_(params.getInt("gor_num_ind")),
-   length_(params.getInt("gor_length")),
-   prizeMult_(params.getFloat("gor_prize_mult")),
+   numInd_(config.gorNumInd),
+   length_(config.gorLength),
+   prizeMult_(config.gorPrizeMult),
    maxStat_(2),
    statScale_(rlfloat_t(length_)/maxStat_),
    premiseBound_(3 + numInd_) {
@@ -194,7 +221,7 @@ void GoRightUncertain::getStateDistribution(const State& premise, act_t action,
    }   
 }
 
-void GoRightUncertain::getStatePredSample(const State& premise, act_t action, State& predictedState) const {
+void GoRightUncertain::getStatePredSample(const State& premise, act_t action, State& predictedState, RNG& rng) const {
    predictedState.clear();
    int direction = action*2 - 1;
    if ((premise[0] < 0.5 and action == 0) or
@@ -208,7 +235,7 @@ void GoRightUncertain::getStatePredSample(const State& premise, act_t action, St
 
    rlfloat_t stat = premise[1 + numInd_];
    size_t flatStat = round(stat/statScale_);
-   long long r = rng_.randomInt();
+   long long r = rng.randomInt();
    predictedState[1 + numInd_] = stat + statScale_*(rlfloat_t(r%(maxStat_ + 1)) - flatStat);
 
    for (size_t i = 1; i <= numInd_; ++i) {
@@ -216,7 +243,7 @@ void GoRightUncertain::getStatePredSample(const State& premise, act_t action, St
    }
    if (premise[0] < length_ - 0.5 and predictedState[0] >= length_ - 0.5) { // Entering prize
       for (size_t i = 1; i <= numInd_; ++i) {
-	 predictedState[i] = (rng_.randomFloat() < 1.0/(maxStat_ + 1));
+	 predictedState[i] = (rng.randomFloat() < 1.0/(maxStat_ + 1));
       }
    } else if (premise[0] >= length_ - 0.5 and predictedState[0] >= length_ - 0.5) { // Staying prize
       bool any1s = false;
@@ -387,3 +414,65 @@ rlfloat_t GoRightUncertain::getTermPrediction(const State&, act_t) const {
 void GoRightUncertain::getTermBounds(const StateBound&, const vector<act_t>&, Bound& termBound) const {
    termBound = {0, 0};
 }
+
+void GoRightUncertain::getRewardPredictionBatch(const vector<State>& premises, const vector<act_t>& actions, vector<rlfloat_t>& rewards) const {
+   rewards.resize(premises.size());
+   // One box and action set, refilled for each premise
+   StateBound premiseBound;
+   vector<act_t> action(1);
+   Bound rewardBound;
+   for (size_t k = 0; k < premises.size(); ++k) {
+      premiseBound.resize(premises[k].size());
+      for (size_t d = 0; d < premises[k].size(); ++d) {
+	 premiseBound[d] = {premises[k][d], premises[k][d]};
+      }
+      action[0] = actions[k];
+      GoRightUncertain::getRewardBounds(premiseBound, action, rewardBound);
+      rewards[k] = rewardBound.lower;
+   }
+}
+
+void GoRightUncertain::getTermPredictionBatch(const vector<State>& premises, const vector<act_t>&, vector<rlfloat_t>& terms) const {
+   terms.assign(premises.size(), 0);
+}
+
+void GoRightUncertain::getStatePredSampleBatch(const vector<State>& premises, const vector<act_t>& actions, vector<State>& samples, const vector<RNG*>& rngs) const {
+   samples.resize(premises.size());
+   for (size_t k = 0; k < premises.size(); ++k) {
+      GoRightUncertain::getStatePredSample(premises[k], actions[k], samples[k], *rngs[k]);
+   }
+}
+
+void GoRightUncertain::getRewardPredSampleBatch(const vector<State>& premises, const vector<act_t>& actions, vector<rlfloat_t>& rewards, const vector<RNG*>&) const {
+   GoRightUncertain::getRewardPredictionBatch(premises, actions, rewards);
+}
+
+void GoRightUncertain::getTermPredSampleBatch(const vector<State>& premises, const vector<act_t>& actions, vector<rlfloat_t>& terms, const vector<RNG*>&) const {
+   GoRightUncertain::getTermPredictionBatch(premises, actions, terms);
+}
+
+void GoRightUncertain::getStateBoundsBatch(const vector<StateBound>& premises, const vector<vector<act_t> >& actions, vector<StateBound>& predictedBounds) const {
+   predictedBounds.resize(premises.size());
+   for (size_t k = 0; k < premises.size(); ++k) {
+      GoRightUncertain::getStateBounds(premises[k], actions[k], predictedBounds[k]);
+   }
+}
+
+void GoRightUncertain::getRewardBoundsBatch(const vector<StateBound>& premises, const vector<vector<act_t> >& actions, vector<Bound>& rewardBounds) const {
+   rewardBounds.resize(premises.size());
+   for (size_t k = 0; k < premises.size(); ++k) {
+      GoRightUncertain::getRewardBounds(premises[k], actions[k], rewardBounds[k]);
+   }
+}
+
+void GoRightUncertain::getTermBoundsBatch(const vector<StateBound>& premises, const vector<vector<act_t> >&, vector<Bound>& termBounds) const {
+   termBounds.assign(premises.size(), {0, 0});
+}
+
+void GoRightUncertain::save(CheckpointWriter& out) const {
+   out.write(rng_);
+}
+
+void GoRightUncertain::load(CheckpointReader& in) {
+   in.read(rng_);
+}
@@ -3,16 +3,24 @@
 
 #include "PredictionModel.hpp"
 #include "RNG.hpp"
-#include "Params.hpp"
+#include "Config.hpp"
 
 class GoRight : public PredictionModel {
   public:
-   GoRight(const Params& params);
+   GoRight(const Config& config);
    virtual ~GoRight() = default;
    
    virtual void getStatePrediction(const State& premise, act_t action, State& predictions) const;
    virtual rlfloat_t getRewardPrediction(const State& premise, act_t action) const;
    virtual rlfloat_t getTermPrediction(const State& premise, act_t action) const;
+
+   virtual void getStatePredictionBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<State>& predictedStates) const;
+   virtual void getRewardPredictionBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<rlfloat_t>& rewards) const;
+   virtual void getTermPredictionBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<rlfloat_t>& terms) const;
+   // Deterministic, so these are the predictions
+   virtual void getStatePredSampleBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<State>& samples, const std::vector<RNG*>& rngs) const;
+   virtual void getRewardPredSampleBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<rlfloat_t>& rewards, const std::vector<RNG*>& rngs) const;
+   virtual void getTermPredSampleBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<rlfloat_t>& terms, const std::vector<RNG*>& rngs) const;
    
   protected:
    std::size_t numInd_;
@@ -24,7 +32,7 @@ class GoRight : public PredictionModel {
 
 class GoRightUncertain : public BBIPredictionModel {
   public:
-   GoRightUncertain(RNG& rng, const Params& params);
+   GoRightUncertain(RNG& rng, const Config& config);
    virtual ~GoRightUncertain() = default;
 
    using BBIPredictionModel::getStateBounds;
@@ -36,7 +44,7 @@ class GoRightUncertain : public BBIPredictionModel {
    virtual void getStateBounds(const State& premise, act_t action, State& predictedState, StateBound& predictedBounds) const;
    
    virtual void getStateDistribution(const State& premise, act_t action, StateNormal& stateDist) const;
-   virtual void getStatePredSample(const State& premise, act_t action, State& predictions) const;
+   virtual void getStatePredSample(const State& premise, act_t action, State& predictions, RNG& rng) const;
 
    using BBIPredictionModel::getRewardPrediction;
    virtual void getRewardBounds(const StateBound& premise, const std::vector<act_t>& action, Bound& rewardBound) const;
@@ -50,7 +58,23 @@ class GoRightUncertain : public BBIPredictionModel {
    using PredictionModel::getTermPrediction;
    virtual rlfloat_t getTermPrediction(const State& premise, act_t action) const;
 
+   virtual void getRewardPredictionBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<rlfloat_t>& rewards) const;
+   virtual void getTermPredictionBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<rlfloat_t>& terms) const;
+   virtual void getStatePredSampleBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<State>& samples, const std::vector<RNG*>& rngs) const;
+   // Only the state is random, so these are the predictions
+   virtual void getRewardPredSampleBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<rlfloat_t>& rewards, const std::vector<RNG*>& rngs) const;
+   virtual void getTermPredSampleBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<rlfloat_t>& terms, const std::vector<RNG*>& rngs) const;
+
+   virtual void getStateBoundsBatch(const std::vector<StateBound>& premises, const std::vector<std::vector<act_t> >& actions, std::vector<StateBound>& predictedBounds) const;
+   virtual void getRewardBoundsBatch(const std::vector<StateBound>& premises, const std::vector<std::vector<act_t> >& actions, std::vector<Bound>& rewardBounds) const;
+   virtual void getTermBoundsBatch(const std::vector<StateBound>& premises, const std::vector<std::vector<act_t> >& actions, std::vector<Bound>& termBounds) const;
+
+   virtual void save(CheckpointWriter& out) const;
+   virtual void load(CheckpointReader& in);
+
   protected:
+   // Samples are drawn from the caller's generator; this one is still seeded
+   // (and checkpointed) so whatever is built after it is seeded as before
    mutable RNG rng_;
 
    std::size_t numInd_;
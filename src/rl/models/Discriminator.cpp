@@ -17,6 +17,27 @@ bool Discriminator::operator==(const Discriminator& other) const {
   return toString() == other.toString();
 }
 
+Discriminator* Discriminator::load(CheckpointReader& in) {
+   unsigned char type;
+   in.read(type);
+   if (type == nullType) {
+      return new NullDiscriminator();
+   } else if (type == propThreshType) {
+      size_t property;
+      rlfloat_t threshold;
+      in.read(property);
+      in.read(threshold);
+      return new PropThreshDiscriminator(property, threshold);
+   } else if (type == oneHotActionType) {
+      act_t act;
+      in.read(act);
+      return new OneHotActionDiscriminator(act);
+   } else {
+      cerr << "Unknown discriminator type " << int(type) << " in checkpoint" << endl;
+      exit(1);
+   }
+}
+
 PropThreshDiscriminator::PropThreshDiscriminator(size_t property, rlfloat_t threshold) : 
    property(property),
    threshold(threshold) {
@@ -55,6 +76,12 @@ Discriminator* PropThreshDiscriminator::clone() const
    return new PropThreshDiscriminator(property, threshold);
 }
 
+void PropThreshDiscriminator::save(CheckpointWriter& out) const {
+   out.write(static_cast<unsigned char>(propThreshType));
+   out.write(property);
+   out.write(threshold);
+}
+
 OneHotActionDiscriminator::OneHotActionDiscriminator(act_t act) :
    act(act) {
 }
@@ -96,3 +123,7 @@ Discriminator* OneHotActionDiscriminator::clone() const
    return new OneHotActionDiscriminator(act);
 }
 
+void OneHotActionDiscriminator::save(CheckpointWriter& out) const {
+   out.write(static_cast<unsigned char>(oneHotActionType));
+   out.write(act);
+}
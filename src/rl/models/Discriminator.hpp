@@ -3,6 +3,7 @@
 
 #include "Example.hpp"
 #include "RLTypes.hpp"
+#include "Checkpoint.hpp"
 
 #include <ostream>
 #include <string>
@@ -27,7 +28,13 @@ class Discriminator
 
    virtual Discriminator* clone() const = 0;
 
+   // Writes a type tag first so that load can rebuild the right subclass
+   virtual void save(CheckpointWriter& out) const = 0;
+   static Discriminator* load(CheckpointReader& in);
+
   protected:
+   enum Type {nullType = 0, propThreshType = 1, oneHotActionType = 2};
+
    std::string saveString;
 };
 
@@ -42,6 +49,7 @@ class NullDiscriminator : public Discriminator
    virtual void alterBound(StateBound&, std::vector<act_t>&, bool) const {}
    virtual std::string toString() const {return "[Null]";}
    virtual Discriminator* clone() const {return new NullDiscriminator();}
+   virtual void save(CheckpointWriter& out) const {out.write(static_cast<unsigned char>(nullType));}
 };
 
 class PropThreshDiscriminator : public Discriminator
@@ -57,6 +65,7 @@ class PropThreshDiscriminator : public Discriminator
    virtual void alterBound(StateBound& bound, std::vector<act_t>& actSet, bool isRight) const;
    virtual std::string toString() const;
    virtual Discriminator* clone() const;
+   virtual void save(CheckpointWriter& out) const;
 };
 
 class OneHotActionDiscriminator : public Discriminator
@@ -68,6 +77,7 @@ class OneHotActionDiscriminator : public Discriminator
    virtual void alterBound(StateBound& bound, std::vector<act_t>& actSet, bool isRight) const;
    virtual std::string toString() const;
    virtual Discriminator* clone() const;
+   virtual void save(CheckpointWriter& out) const;
 
   protected:
    act_t act;
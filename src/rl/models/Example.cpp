@@ -29,6 +29,11 @@ const Trajectory* Example::getTraj() const
    return &traj;
 }
 
+size_t Example::getTimeStep() const
+{
+   return timestep;
+}
+
 FullVecExample::FullVecExample(const Trajectory& traj, size_t timestep) :
    Example(traj, timestep)   
 {
@@ -20,6 +20,7 @@ class Example
    virtual const State& getOutcome() const;
    virtual act_t getAction() const;
    virtual const Trajectory* getTraj() const;
+   virtual std::size_t getTimeStep() const;
 };
 
 class FullVecExample : public Example
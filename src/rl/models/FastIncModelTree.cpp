@@ -1,16 +1,17 @@
 #include "FastIncModelTree.hpp"
 #include "dout.hpp"
+#include "Trace.hpp"
 
 using namespace std;
 
-FastIncModelTree::FastIncModelTree(size_t inDim, act_t numActions, RNG& initRNG, const Params& params) :
+FastIncModelTree::FastIncModelTree(size_t inDim, act_t numActions, RNG& initRNG, const Config& config) :
    inDim_{inDim},
    numActions_{numActions},
    root_{new Decision(inDim_, numActions_, "X")},
    numLeaves_{1},
-   maxLeaves_(params.getInt("max_leaves")),
-   confidence_(params.getFloat("split_confidence")),
-   tieThreshold_(params.getFloat("tie_threshold")),
+   maxLeaves_(config.maxLeaves),
+   confidence_(config.splitConfidence),
+   tieThreshold_(config.tieThreshold),
    rng_(initRNG.randomInt()) {
 }
 
@@ -183,6 +184,7 @@ void FastIncModelTree::insertThreshold(Threshold*& n, Threshold* parent, rlfloat
 }
 
 void FastIncModelTree::split() {
+   TRACE_SCOPE("FastIncModelTree::split");
    if (numLeaves_ < maxLeaves_) {
       split(root_);
    }
@@ -481,14 +483,14 @@ void FastIncModelTree::getPredDist(const State& premise, act_t action, vector<No
    }
 }
 
-void FastIncModelTree::getPredSample(const State& premise, act_t action, State& sample) const {
+void FastIncModelTree::getPredSample(const State& premise, act_t action, State& sample, RNG& rng) const {
    Decision* n = getNode(premise, action);
 
    sample.clear();
    rlfloat_t var = (n->predStats.sumSq - n->predStats.sum*n->predStats.sum/n->predStats.count)/(n->predStats.count - 1);
    rlfloat_t s;
    if (var > 1e-6) {
-      s = rng_.gaussian(n->predStats.sum/n->predStats.count, sqrt(var));
+      s = rng.gaussian(n->predStats.sum/n->predStats.count, sqrt(var));
    } else {
       s = n->predStats.sum/n->predStats.count;
    }
@@ -566,3 +568,139 @@ void FastIncModelTree::getDontKnowPrediction(Decision* n,
       }
    }
 }
+
+void FastIncModelTree::addFootprint(Footprint& footprint) const {
+   addDecisionFootprint(footprint, root_);
+}
+
+void FastIncModelTree::addDecisionFootprint(Footprint& footprint, const Decision* n) const {
+   footprint.add(Footprint::decisions, 1,
+		 sizeof(Decision) +
+		 Footprint::heapBytes(n->locStr) +
+		 Footprint::heapBytes(n->threshRoots) +
+		 Footprint::heapBytes(n->actionSplits));
+   for (auto t : n->threshRoots) {
+      addThresholdFootprint(footprint, t);
+   }
+   if (n->left) {
+      addDecisionFootprint(footprint, n->left);
+   }
+   if (n->right) {
+      addDecisionFootprint(footprint, n->right);
+   }
+}
+
+void FastIncModelTree::addThresholdFootprint(Footprint& footprint, const Threshold* n) const {
+   if (!n) {
+      return;
+   }
+   footprint.add(Footprint::thresholds, 1, sizeof(Threshold));
+   addThresholdFootprint(footprint, n->left);
+   addThresholdFootprint(footprint, n->right);
+}
+
+void FastIncModelTree::save(CheckpointWriter& out) const {
+   out.write(numLeaves_);
+   out.write(rng_);
+   saveDecision(out, root_);
+}
+
+void FastIncModelTree::load(CheckpointReader& in) {
+   in.read(numLeaves_);
+   in.read(rng_);
+   delete root_;
+   root_ = loadDecision(in);
+}
+
+void FastIncModelTree::saveStats(CheckpointWriter& out, const Stats& stats) const {
+   out.write(stats.sum);
+   out.write(stats.sumSq);
+   out.write(stats.min);
+   out.write(stats.max);
+   out.write(stats.count);
+}
+
+void FastIncModelTree::loadStats(CheckpointReader& in, Stats& stats) {
+   in.read(stats.sum);
+   in.read(stats.sumSq);
+   in.read(stats.min);
+   in.read(stats.max);
+   in.read(stats.count);
+}
+
+// Pre-order, so the (unbalanced) threshold trees come back with the same shape
+void FastIncModelTree::saveThreshold(CheckpointWriter& out, const Threshold* n) const {
+   out.write(static_cast<unsigned char>(n != nullptr));
+   if (n) {
+      out.write(n->threshold);
+      saveStats(out, n->stats.left);
+      saveStats(out, n->stats.right);
+      out.write(n->hereAndRightMin);
+      out.write(n->hereAndRightMax);
+      saveThreshold(out, n->left);
+      saveThreshold(out, n->right);
+   }
+}
+
+FastIncModelTree::Threshold* FastIncModelTree::loadThreshold(CheckpointReader& in, Threshold* parent) {
+   unsigned char present;
+   in.read(present);
+   if (!present) {
+      return nullptr;
+   }
+
+   rlfloat_t threshold;
+   in.read(threshold);
+   Threshold* n = new Threshold(threshold, parent);
+   loadStats(in, n->stats.left);
+   loadStats(in, n->stats.right);
+   in.read(n->hereAndRightMin);
+   in.read(n->hereAndRightMax);
+   n->left = loadThreshold(in, n);
+   n->right = loadThreshold(in, n);
+   return n;
+}
+
+void FastIncModelTree::saveDecision(CheckpointWriter& out, const Decision* n) const {
+   out.write(n->locStr);
+   saveStats(out, n->predStats);
+   out.write(n->splitCount);
+   for (auto r : n->threshRoots) {
+      saveThreshold(out, r);
+   }
+   for (auto& s : n->actionSplits) {
+      saveStats(out, s.left);
+      saveStats(out, s.right);
+   }
+
+   out.write(static_cast<unsigned char>(n->discriminator != nullptr));
+   if (n->discriminator) {
+      n->discriminator->save(out);
+      saveDecision(out, n->left);
+      saveDecision(out, n->right);
+   }
+}
+
+FastIncModelTree::Decision* FastIncModelTree::loadDecision(CheckpointReader& in) {
+   string locStr;
+   in.read(locStr);
+   Decision* n = new Decision(inDim_, numActions_, locStr);
+   loadStats(in, n->predStats);
+   in.read(n->splitCount);
+   for (auto& r : n->threshRoots) {
+      r = loadThreshold(in, nullptr);
+   }
+   for (auto& s : n->actionSplits) {
+      loadStats(in, s.left);
+      loadStats(in, s.right);
+   }
+
+   unsigned char split;
+   in.read(split);
+   if (split) {
+      n->discriminator = Discriminator::load(in);
+      n->left = loadDecision(in);
+      n->right = loadDecision(in);
+   }
+   return n;
+}
@@ -1,7 +1,7 @@
 #ifndef FAST_INC_MODEL_TREE
 #define FAST_INC_MODEL_TREE
 
-#include "Params.hpp"
+#include "Config.hpp"
 #include "Example.hpp"
 #include "Discriminator.hpp"
 #include "RNG.hpp"
@@ -13,12 +13,14 @@
 // TODO: Could extend this to multi-dimensional targets and linear leaf models
 class FastIncModelTree {
   public:
-   FastIncModelTree(size_t inDim, act_t numActions, RNG& initRNG, const Params& params);
+   FastIncModelTree(size_t inDim, act_t numActions, RNG& initRNG, const Config& config);
    virtual ~FastIncModelTree();
 
    virtual void addExample(Example* ex);
    virtual void split();
 
+   std::size_t getNumLeaves() const {return numLeaves_;}
+
    // Predicts the expected value of the outcome from an input
    virtual void getPrediction(const State& premise, act_t action, State& pred) const;
    // Predicts the bound of the outcome value from an input
@@ -28,7 +30,14 @@ class FastIncModelTree {
    // Gives a mean and variance of the outcome value from an input
    virtual void getPredDist(const State& premise, act_t action, std::vector<Normal>& dist) const;
    // Samples an outcome from an input
-   virtual void getPredSample(const State& premise, act_t action, State& sample) const;
+   virtual void getPredSample(const State& premise, act_t action, State& sample, RNG& rng) const;
+
+   // The whole tree, including the split statistics gathered at the leaves
+   // Decision nodes, and the threshold trees the leaves keep for choosing splits
+   virtual void addFootprint(Footprint& footprint) const;
+
+   virtual void save(CheckpointWriter& out) const;
+   virtual void load(CheckpointReader& in);
 
   protected:
    struct Stats {
@@ -87,6 +96,8 @@ class FastIncModelTree {
    size_t maxLeaves_;
    rlfloat_t confidence_;
    rlfloat_t tieThreshold_;
+   // Samples are drawn from the caller's generator; this one is still seeded
+   // (and checkpointed) so the trees built after it are seeded as before
    mutable RNG rng_;
    
    virtual void addExampleHelper(Decision* n, Example* ex);
@@ -108,6 +119,16 @@ class FastIncModelTree {
 
    virtual Decision* getNode(const State& premise, act_t action) const;
 
+   virtual void addDecisionFootprint(Footprint& footprint, const Decision* n) const;
+   virtual void addThresholdFootprint(Footprint& footprint, const Threshold* n) const;
+
+   virtual void saveStats(CheckpointWriter& out, const Stats& stats) const;
+   virtual void loadStats(CheckpointReader& in, Stats& stats);
+   virtual void saveThreshold(CheckpointWriter& out, const Threshold* n) const;
+   virtual Threshold* loadThreshold(CheckpointReader& in, Threshold* parent);
+   virtual void saveDecision(CheckpointWriter& out, const Decision* n) const;
+   virtual Decision* loadDecision(CheckpointReader& in);
+
    virtual void getDontKnowPrediction(Decision* n,
 				      const StateBound& premise,
 				      const std::vector<act_t>& action,
@@ -6,18 +6,18 @@ using namespace std;
 IncDTModel::IncDTModel(size_t inDim,
 		 act_t numActions,
 		 RNG& rng,
-		 const Params& params) :
-   predictChange_(params.getInt("predict_change")),
+		 const Config& config) :
+   predictChange_(config.predictChange),
    rng_{rng.randomInt()} {
    for (size_t i = 0; i < inDim; ++i) {
-      stateModels_.push_back(new FastIncModelTree{inDim, numActions, rng, params});
+      stateModels_.push_back(new FastIncModelTree{inDim, numActions, rng, config});
       models_.push_back(stateModels_.back());
    }
          
-   rwdModel_ = new FastIncModelTree{inDim, numActions, rng, params};
+   rwdModel_ = new FastIncModelTree{inDim, numActions, rng, config};
    models_.push_back(rwdModel_);
 
-   termModel_ = new FastIncModelTree{inDim, numActions, rng, params};
+   termModel_ = new FastIncModelTree{inDim, numActions, rng, config};
    models_.push_back(termModel_);
 }
 
@@ -158,11 +158,11 @@ void IncDTModel::getTermDistribution(const State& premise, act_t action, Normal&
    termDist = dist[0];
 }
 
-void IncDTModel::getStatePredSample(const State& premise, act_t action, State& sample) const {
+void IncDTModel::getStatePredSample(const State& premise, act_t action, State& sample, RNG& rng) const {
    sample.clear();
    for (size_t i = 0; i < stateModels_.size(); ++i) {
       State pred;
-      stateModels_[i]->getPredSample(premise, action, pred);
+      stateModels_[i]->getPredSample(premise, action, pred, rng);
       sample.push_back(pred[0]);
       if (predictChange_) {
 	 sample.back() += premise[i];
@@ -170,14 +170,149 @@ void IncDTModel::getStatePredSample(const State& premise, act_t action, State& s
    }
 }
 
-rlfloat_t IncDTModel::getRewardPredSample(const State& premise, act_t action) const {
+rlfloat_t IncDTModel::getRewardPredSample(const State& premise, act_t action, RNG& rng) const {
    State pred;
-   rwdModel_->getPredSample(premise, action, pred);
+   rwdModel_->getPredSample(premise, action, pred, rng);
    return pred[0];
 }
 
-bool IncDTModel::getTermPredSample(const State& premise, act_t action) const {
+bool IncDTModel::getTermPredSample(const State& premise, act_t action, RNG& rng) const {
    State pred;
-   termModel_->getPredSample(premise, action, pred);
+   termModel_->getPredSample(premise, action, pred, rng);
    return pred[0] > 0.5;
 }
+
+void IncDTModel::getStatePredictionBatch(const vector<State>& premises, const vector<act_t>& actions, vector<State>& predictedStates) const {
+   predictedStates.resize(premises.size());
+   for (auto& s : predictedStates) {
+      s.resize(stateModels_.size());
+   }
+   State pred;
+   for (size_t i = 0; i < stateModels_.size(); ++i) {
+      for (size_t k = 0; k < premises.size(); ++k) {
+	 stateModels_[i]->getPrediction(premises[k], actions[k], pred);
+	 predictedStates[k][i] = pred[0];
+	 if (predictChange_) {
+	    predictedStates[k][i] += premises[k][i];
+	 }
+      }
+   }
+}
+
+void IncDTModel::getRewardPredictionBatch(const vector<State>& premises, const vector<act_t>& actions, vector<rlfloat_t>& rewards) const {
+   rewards.resize(premises.size());
+   State pred;
+   for (size_t k = 0; k < premises.size(); ++k) {
+      rwdModel_->getPrediction(premises[k], actions[k], pred);
+      rewards[k] = pred[0];
+   }
+}
+
+void IncDTModel::getTermPredictionBatch(const vector<State>& premises, const vector<act_t>& actions, vector<rlfloat_t>& terms) const {
+   terms.resize(premises.size());
+   State pred;
+   for (size_t k = 0; k < premises.size(); ++k) {
+      termModel_->getPrediction(premises[k], actions[k], pred);
+      terms[k] = pred[0];
+   }
+}
+
+void IncDTModel::getStatePredSampleBatch(const vector<State>& premises, const vector<act_t>& actions, vector<State>& samples, const vector<RNG*>& rngs) const {
+   samples.resize(premises.size());
+   for (auto& s : samples) {
+      s.resize(stateModels_.size());
+   }
+   // Each premise still draws for its dimensions in order
+   State pred;
+   for (size_t i = 0; i < stateModels_.size(); ++i) {
+      for (size_t k = 0; k < premises.size(); ++k) {
+	 stateModels_[i]->getPredSample(premises[k], actions[k], pred, *rngs[k]);
+	 samples[k][i] = pred[0];
+	 if (predictChange_) {
+	    samples[k][i] += premises[k][i];
+	 }
+      }
+   }
+}
+
+void IncDTModel::getRewardPredSampleBatch(const vector<State>& premises, const vector<act_t>& actions, vector<rlfloat_t>& rewards, const vector<RNG*>& rngs) const {
+   rewards.resize(premises.size());
+   State pred;
+   for (size_t k = 0; k < premises.size(); ++k) {
+      rwdModel_->getPredSample(premises[k], actions[k], pred, *rngs[k]);
+      rewards[k] = pred[0];
+   }
+}
+
+void IncDTModel::getTermPredSampleBatch(const vector<State>& premises, const vector<act_t>& actions, vector<rlfloat_t>& terms, const vector<RNG*>& rngs) const {
+   terms.resize(premises.size());
+   State pred;
+   for (size_t k = 0; k < premises.size(); ++k) {
+      termModel_->getPredSample(premises[k], actions[k], pred, *rngs[k]);
+      terms[k] = pred[0] > 0.5;
+   }
+}
+
+void IncDTModel::getStateBoundsBatch(const vector<StateBound>& premises, const vector<vector<act_t> >& actions, vector<StateBound>& predictedBounds) const {
+   predictedBounds.resize(premises.size());
+   for (auto& b : predictedBounds) {
+      b.resize(stateModels_.size());
+   }
+   vector<Bound> pred(1);
+   for (size_t i = 0; i < stateModels_.size(); ++i) {
+      for (size_t k = 0; k < premises.size(); ++k) {
+	 stateModels_[i]->getPredBounds(premises[k], actions[k], pred);
+	 predictedBounds[k][i] = pred[0];
+	 if (predictChange_) {
+	    predictedBounds[k][i].lower += premises[k][i].lower;
+	    predictedBounds[k][i].upper += premises[k][i].upper;
+	 }
+      }
+   }
+}
+
+void IncDTModel::getRewardBoundsBatch(const vector<StateBound>& premises, const vector<vector<act_t> >& actions, vector<Bound>& rewardBounds) const {
+   rewardBounds.resize(premises.size());
+   vector<Bound> bounds;
+   for (size_t k = 0; k < premises.size(); ++k) {
+      rwdModel_->getPredBounds(premises[k], actions[k], bounds);
+      rewardBounds[k] = bounds[0];
+   }
+}
+
+void IncDTModel::getTermBoundsBatch(const vector<StateBound>& premises, const vector<vector<act_t> >& actions, vector<Bound>& termBounds) const {
+   termBounds.resize(premises.size());
+   vector<Bound> bounds;
+   for (size_t k = 0; k < premises.size(); ++k) {
+      termModel_->getPredBounds(premises[k], actions[k], bounds);
+      termBounds[k] = bounds[0];
+   }
+}
+
+size_t IncDTModel::getNumLeaves() const {
+   size_t numLeaves = 0;
+   for (auto m : models_) {
+      numLeaves += m->getNumLeaves();
+   }
+   return numLeaves;
+}
+
+void IncDTModel::addFootprint(Footprint& footprint) const {
+   for (auto m : models_) {
+      m->addFootprint(footprint);
+   }
+}
+
+void IncDTModel::save(CheckpointWriter& out) const {
+   out.write(rng_);
+   for (auto m : models_) {
+      m->save(out);
+   }
+}
+
+void IncDTModel::load(CheckpointReader& in) {
+   in.read(rng_);
+   for (auto m : models_) {
+      m->load(in);
+   }
+}
@@ -3,12 +3,12 @@
 
 #include "FastIncModelTree.hpp"
 #include "PredictionModel.hpp"
-#include "Params.hpp"
+#include "Config.hpp"
 #include "RNG.hpp"
 
 class IncDTModel : public LearnedModel, public BBIPredictionModel {
   public:
-   IncDTModel(size_t inDim, act_t numActions, RNG& rng, const Params& params);
+   IncDTModel(size_t inDim, act_t numActions, RNG& rng, const Config& config);
    virtual ~IncDTModel();
 
    virtual void addExample(const Trajectory& traj, size_t t);
@@ -17,6 +17,8 @@ class IncDTModel : public LearnedModel, public BBIPredictionModel {
    
    virtual void updatePredictions();
 
+   virtual size_t getNumLeaves() const;
+
    using PredictionModel::getStatePrediction;
    virtual void getStatePrediction(const State& premise, act_t action, State& predictedState) const;
    using PredictionModel::getStateBounds;
@@ -45,9 +47,26 @@ class IncDTModel : public LearnedModel, public BBIPredictionModel {
    virtual void getRewardDistribution(const State& premise, act_t action, Normal& rewardDist) const;
    virtual void getTermDistribution(const State& premise, act_t action, Normal& termDist) const;
    
-   virtual void getStatePredSample(const State& premise, act_t action, State& sample) const;
-   virtual rlfloat_t getRewardPredSample(const State& premise, act_t action) const;
-   virtual bool getTermPredSample(const State& premise, act_t action) const;
+   virtual void getStatePredSample(const State& premise, act_t action, State& sample, RNG& rng) const;
+   virtual rlfloat_t getRewardPredSample(const State& premise, act_t action, RNG& rng) const;
+   virtual bool getTermPredSample(const State& premise, act_t action, RNG& rng) const;
+
+   // Each tree is taken in turn through the whole batch
+   virtual void getStatePredictionBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<State>& predictedStates) const;
+   virtual void getRewardPredictionBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<rlfloat_t>& rewards) const;
+   virtual void getTermPredictionBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<rlfloat_t>& terms) const;
+   virtual void getStatePredSampleBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<State>& samples, const std::vector<RNG*>& rngs) const;
+   virtual void getRewardPredSampleBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<rlfloat_t>& rewards, const std::vector<RNG*>& rngs) const;
+   virtual void getTermPredSampleBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<rlfloat_t>& terms, const std::vector<RNG*>& rngs) const;
+
+   virtual void getStateBoundsBatch(const std::vector<StateBound>& premises, const std::vector<std::vector<act_t> >& actions, std::vector<StateBound>& predictedBounds) const;
+   virtual void getRewardBoundsBatch(const std::vector<StateBound>& premises, const std::vector<std::vector<act_t> >& actions, std::vector<Bound>& rewardBounds) const;
+   virtual void getTermBoundsBatch(const std::vector<StateBound>& premises, const std::vector<std::vector<act_t> >& actions, std::vector<Bound>& termBounds) const;
+
+   virtual void addFootprint(Footprint& footprint) const;
+
+   virtual void save(CheckpointWriter& out) const;
+   virtual void load(CheckpointReader& in);
 
   private:
    bool predictChange_;
@@ -1,20 +1,22 @@
 #include "NNModel.hpp"
 #include "dout.hpp"
+#include "Trace.hpp"
 
 #include <memory>
+#include <sstream>
 #include <algorithm>
 
 using namespace std;
 
-NNModel::NNModel(size_t inDim, size_t targetDim, act_t numActions, const vector<Bound>& dimBounds, RNG& rng, TrainingType trainType, const Params& params) :
+NNModel::NNModel(size_t inDim, size_t targetDim, act_t numActions, const vector<Bound>& dimBounds, RNG& rng, TrainingType trainType, const Config& config) :
    inDim_{inDim},
    numActions_{numActions},
    targetDim_{targetDim},   
-   batchSize_(params.getInt("batch_size")),
+   batchSize_(config.batchSize),
    rng_{rng.randomInt()},
    trainType_{trainType},
-   varianceSmoothing_(params.getFloat("variance_smoothing")),
-   predictChange_(params.getInt("predict_change")) {
+   varianceSmoothing_(config.varianceSmoothing),
+   predictChange_(config.predictChange) {
 
    netInDim_ = inDim_ + numActions_;
    if (trainType_ == iqn) {
@@ -30,10 +32,10 @@ NNModel::NNModel(size_t inDim, size_t targetDim, act_t numActions, const vector<
       netOutDim = 2;
    }
 
-   vector<size_t> sizes({size_t(params.getInt("hidden_size"))});
+   vector<size_t> sizes({config.hiddenSize});
    for (size_t i = 0; i < inDim + 2; ++i) {
       nets_.push_back(make_shared<Net>(netInDim_, sizes, netOutDim));
-      optimizers_.push_back(make_shared<torch::optim::Adam>(nets_.back()->parameters(), params.getFloat("nn_step_size")));
+      optimizers_.push_back(make_shared<torch::optim::Adam>(nets_.back()->parameters(), config.nnStepSize));
    }
 
    for (auto r : dimBounds) {
@@ -142,6 +144,7 @@ void NNModel::removeTrajectory(const Trajectory* traj) {
 }
 
 void NNModel::updatePredictions() {
+   TRACE_SCOPE("NNModel::updatePredictions");
    for (auto net : nets_) {
       net->train();
    }
@@ -462,7 +465,7 @@ void NNModel::getTermDistribution(const State& premise, act_t action, Normal& te
    }   
 }
 
-void NNModel::getStatePredSample(const State& premise, act_t action, State& predictions) const {
+void NNModel::getStatePredSample(const State& premise, act_t action, State& predictions, RNG& rng) const {
    c10::InferenceMode guard;
    for (size_t i = 0; i < inDim_; ++i) {
       nets_[i]->eval();
@@ -474,7 +477,7 @@ void NNModel::getStatePredSample(const State& premise, act_t action, State& pred
       StateNormal stateDist;
       getStateDistribution(premise, action, stateDist);
       for (size_t i = 0; i < inDim_; ++i) {
-	 predictions.push_back(rng_.gaussian(stateDist[i].mean, sqrt(stateDist[i].var)));
+	 predictions.push_back(rng.gaussian(stateDist[i].mean, sqrt(stateDist[i].var)));
 
 	 if (predictChange_) {
 	    predictions.back() += premise[i];
@@ -484,7 +487,7 @@ void NNModel::getStatePredSample(const State& premise, act_t action, State& pred
       vector<double> inputVec;
       prepareInputVector(premise, action, inputVec);
       for (size_t i = 0; i < inDim_; ++i) {
-	 inputVec.push_back(rng_.randomFloat());
+	 inputVec.push_back(rng.randomFloat());
 	 torch::Tensor in = at::unsqueeze(torch::tensor(inputVec), 0);
 	 torch::Tensor out = nets_[i]->forward(in);
 	 predictions.push_back(out[0][0].item<rlfloat_t>());
@@ -499,18 +502,18 @@ void NNModel::getStatePredSample(const State& premise, act_t action, State& pred
    }
 }
 
-rlfloat_t NNModel::getRewardPredSample(const State& premise, act_t action) const {
+rlfloat_t NNModel::getRewardPredSample(const State& premise, act_t action, RNG& rng) const {
    c10::InferenceMode guard;
    nets_[inDim_]->eval();
 
    if (trainType_ == gaussian) {
       Normal dist;
       getRewardDistribution(premise, action, dist);
-      return rng_.gaussian(dist.mean, sqrt(dist.var));
+      return rng.gaussian(dist.mean, sqrt(dist.var));
    } else if (trainType_ == iqn) {
       vector<double> inputVec;
       prepareInputVector(premise, action, inputVec);
-      inputVec.push_back(rng_.randomFloat());      
+      inputVec.push_back(rng.randomFloat());      
       torch::Tensor in = at::unsqueeze(torch::tensor(inputVec), 0);
       torch::Tensor out = nets_[inDim_]->forward(in);
       return out[0][0].item<rlfloat_t>();
@@ -519,18 +522,18 @@ rlfloat_t NNModel::getRewardPredSample(const State& premise, act_t action) const
    }
 }
 
-bool NNModel::getTermPredSample(const State& premise, act_t action) const {
+bool NNModel::getTermPredSample(const State& premise, act_t action, RNG& rng) const {
    c10::InferenceMode guard;
    nets_[inDim_+1]->eval();
 
    if (trainType_ == gaussian) {
       Normal dist;
       getTermDistribution(premise, action, dist);
-      return rng_.gaussian(dist.mean, sqrt(dist.var));
+      return rng.gaussian(dist.mean, sqrt(dist.var));
    } else if (trainType_ == iqn) {
       vector<double> inputVec;
       prepareInputVector(premise, action, inputVec);
-      inputVec.push_back(rng_.randomFloat());
+      inputVec.push_back(rng.randomFloat());
       torch::Tensor in = at::unsqueeze(torch::tensor(inputVec), 0);
       torch::Tensor out = nets_[inDim_+1]->forward(in);
       return out[0][0].item<rlfloat_t>() >= 0.5;
@@ -539,6 +542,202 @@ bool NNModel::getTermPredSample(const State& premise, act_t action) const {
    }
 }
 
+// Copies column c of a batch of network outputs, one entry per row
+static void getColumn(const torch::Tensor& out, long c, vector<rlfloat_t>& column) {
+   torch::Tensor col = out.index({torch::indexing::Slice(), c}).to(torch::kFloat).contiguous();
+   const float* data = col.data_ptr<float>();
+   column.assign(data, data + col.numel());
+}
+
+void NNModel::getStatePredictionBatch(const vector<State>& premises, const vector<act_t>& actions, vector<State>& predictions) const {
+   predictions.resize(premises.size());
+   if (premises.empty()) {
+      return;
+   }
+
+   c10::InferenceMode guard;
+   for (size_t i = 0; i < inDim_; ++i) {
+      nets_[i]->eval();
+   }
+
+   torch::Tensor in = prepareInput(premises, actions, vector<double>());
+   for (auto& p : predictions) {
+      p.resize(inDim_);
+   }
+   vector<rlfloat_t> column;
+   for (size_t i = 0; i < inDim_; ++i) {
+      getColumn(nets_[i]->forward(in), trainType_ == bound ? 1 : 0, column);
+      for (size_t k = 0; k < premises.size(); ++k) {
+	 predictions[k][i] = column[k];
+
+	 if (predictChange_) {
+	    predictions[k][i] += premises[k][i];
+	 }
+      }
+   }
+}
+
+void NNModel::getRewardPredictionBatch(const vector<State>& premises, const vector<act_t>& actions, vector<rlfloat_t>& rewards) const {
+   rewards.clear();
+   if (premises.empty()) {
+      return;
+   }
+
+   c10::InferenceMode guard;
+   nets_[inDim_]->eval();
+
+   torch::Tensor in = prepareInput(premises, actions, vector<double>());
+   getColumn(nets_[inDim_]->forward(in), trainType_ == bound ? 1 : 0, rewards);
+}
+
+void NNModel::getTermPredictionBatch(const vector<State>& premises, const vector<act_t>& actions, vector<rlfloat_t>& terms) const {
+   terms.clear();
+   if (premises.empty()) {
+      return;
+   }
+
+   c10::InferenceMode guard;
+   nets_[inDim_+1]->eval();
+
+   torch::Tensor in = prepareInput(premises, actions, vector<double>());
+   getColumn(nets_[inDim_+1]->forward(in), trainType_ == bound ? 1 : 0, terms);
+}
+
+void NNModel::getStatePredSampleBatch(const vector<State>& premises, const vector<act_t>& actions, vector<State>& predictions, const vector<RNG*>& rngs) const {
+   if (trainType_ != gaussian and trainType_ != iqn) {
+      getStatePredictionBatch(premises, actions, predictions);
+      return;
+   }
+
+   predictions.resize(premises.size());
+   if (premises.empty()) {
+      return;
+   }
+
+   c10::InferenceMode guard;
+   for (size_t i = 0; i < inDim_; ++i) {
+      nets_[i]->eval();
+   }
+
+   for (auto& p : predictions) {
+      p.resize(inDim_);
+   }
+   vector<rlfloat_t> column;
+   if (trainType_ == gaussian) {
+      torch::Tensor in = prepareInput(premises, actions, vector<double>());
+      vector<vector<rlfloat_t> > means(inDim_);
+      vector<vector<rlfloat_t> > vars(inDim_);
+      for (size_t i = 0; i < inDim_; ++i) {
+	 torch::Tensor out = nets_[i]->forward(in);
+	 getColumn(out, 0, means[i]);
+	 getColumn(out, 1, vars[i]);
+      }
+
+      // Each premise draws for its dimensions in order, as getStatePredSample does
+      for (size_t k = 0; k < premises.size(); ++k) {
+	 for (size_t i = 0; i < inDim_; ++i) {
+	    rlfloat_t mean = means[i][k];
+	    rlfloat_t var = max(vars[i][k], rlfloat_t(0)) + varianceSmoothing_;
+	    if (predictChange_) {
+	       mean += premises[k][i];
+	    }
+	    predictions[k][i] = rngs[k]->gaussian(mean, sqrt(var));
+
+	    if (predictChange_) {
+	       predictions[k][i] += premises[k][i];
+	    }
+	 }
+      }
+   } else {
+      vector<double> quantiles(premises.size());
+      for (size_t i = 0; i < inDim_; ++i) {
+	 for (size_t k = 0; k < premises.size(); ++k) {
+	    quantiles[k] = rngs[k]->randomFloat();
+	 }
+	 torch::Tensor in = prepareInput(premises, actions, quantiles);
+	 getColumn(nets_[i]->forward(in), 0, column);
+	 for (size_t k = 0; k < premises.size(); ++k) {
+	    predictions[k][i] = column[k];
+
+	    if (predictChange_) {
+	       predictions[k][i] += premises[k][i];
+	    }
+	 }
+      }
+   }
+}
+
+void NNModel::getRewardPredSampleBatch(const vector<State>& premises, const vector<act_t>& actions, vector<rlfloat_t>& rewards, const vector<RNG*>& rngs) const {
+   if (trainType_ != gaussian and trainType_ != iqn) {
+      getRewardPredictionBatch(premises, actions, rewards);
+      return;
+   }
+
+   rewards.clear();
+   if (premises.empty()) {
+      return;
+   }
+
+   c10::InferenceMode guard;
+   nets_[inDim_]->eval();
+
+   if (trainType_ == gaussian) {
+      torch::Tensor out = nets_[inDim_]->forward(prepareInput(premises, actions, vector<double>()));
+      vector<rlfloat_t> vars;
+      getColumn(out, 0, rewards);
+      getColumn(out, 1, vars);
+      for (size_t k = 0; k < premises.size(); ++k) {
+	 rlfloat_t var = max(vars[k], rlfloat_t(0)) + varianceSmoothing_;
+	 rewards[k] = rngs[k]->gaussian(rewards[k], sqrt(var));
+      }
+   } else {
+      vector<double> quantiles(premises.size());
+      for (size_t k = 0; k < premises.size(); ++k) {
+	 quantiles[k] = rngs[k]->randomFloat();
+      }
+      getColumn(nets_[inDim_]->forward(prepareInput(premises, actions, quantiles)), 0, rewards);
+   }
+}
+
+void NNModel::getTermPredSampleBatch(const vector<State>& premises, const vector<act_t>& actions, vector<rlfloat_t>& terms, const vector<RNG*>& rngs) const {
+   if (trainType_ != gaussian and trainType_ != iqn) {
+      getTermPredictionBatch(premises, actions, terms);
+      for (auto& t : terms) {
+	 t = t >= 0.5;
+      }
+      return;
+   }
+
+   terms.clear();
+   if (premises.empty()) {
+      return;
+   }
+
+   c10::InferenceMode guard;
+   nets_[inDim_+1]->eval();
+
+   if (trainType_ == gaussian) {
+      torch::Tensor out = nets_[inDim_+1]->forward(prepareInput(premises, actions, vector<double>()));
+      vector<rlfloat_t> vars;
+      getColumn(out, 0, terms);
+      getColumn(out, 1, vars);
+      for (size_t k = 0; k < premises.size(); ++k) {
+	 rlfloat_t var = max(vars[k], rlfloat_t(0)) + varianceSmoothing_;
+	 // Any nonzero draw counts as termination, as in getTermPredSample
+	 terms[k] = rngs[k]->gaussian(terms[k], sqrt(var)) != 0;
+      }
+   } else {
+      vector<double> quantiles(premises.size());
+      for (size_t k = 0; k < premises.size(); ++k) {
+	 quantiles[k] = rngs[k]->randomFloat();
+      }
+      getColumn(nets_[inDim_+1]->forward(prepareInput(premises, actions, quantiles)), 0, terms);
+      for (auto& t : terms) {
+	 t = t >= 0.5;
+      }
+   }
+}
+
 void NNModel::prepareInputVector(const State& premise, act_t action, vector<double>& inVec) const {
    for (size_t i = 0; i < inDim_; ++i) {
       inVec.push_back((premise[i] + inputShift_[i])*inputScale_[i]);
@@ -589,3 +788,96 @@ torch::Tensor NNModel::prepareInput(const StateBound& premise, const vector<act_
    
    return in;
 }
+
+torch::Tensor NNModel::prepareInput(const vector<State>& premises, const vector<act_t>& actions, const vector<double>& quantiles) const {
+   vector<double> batchInVec;
+   vector<double> inVec;
+   for (size_t k = 0; k < premises.size(); ++k) {
+      inVec.clear();
+      prepareInputVector(premises[k], actions[k], inVec);
+      if (!quantiles.empty()) {
+	 inVec.push_back(quantiles[k]);
+      }
+      batchInVec.insert(batchInVec.end(), inVec.begin(), inVec.end());
+   }
+
+   long long width = inDim_ + numActions_ + (quantiles.empty() ? 0 : 1);
+   return at::reshape(torch::tensor(batchInVec), {-1, width});
+}
+
+void NNModel::addFootprint(Footprint& footprint) const {
+   // The networks are fixed in size; the training examples pile up
+   size_t numExamples = 0;
+   size_t bytes = Footprint::heapBytes(allExamples_);
+   for (const auto& exList : allExamples_) {
+      bytes += Footprint::heapBytes(exList);
+      for (auto ex : exList) {
+	 ++numExamples;
+	 bytes += sizeof(FullOutcomeExample) + Footprint::heapBytes(ex->getOutcome());
+      }
+   }
+   footprint.add(Footprint::examples, numExamples, bytes);
+}
+
+void NNModel::save(CheckpointWriter& out) const {
+   out.write(rng_);
+
+   out.write(allExamples_.size());
+   for (const auto& exList : allExamples_) {
+      out.write(out.getTrajectoryIndex(exList[0]->getTraj()));
+      out.write(exList[0]->getTimeStep());
+   }
+
+   torch::serialize::OutputArchive archive;
+   for (size_t i = 0; i < nets_.size(); ++i) {
+      torch::serialize::OutputArchive netArchive;
+      nets_[i]->save(netArchive);
+      archive.write("net" + to_string(i), netArchive);
+
+      torch::serialize::OutputArchive optimizerArchive;
+      optimizers_[i]->save(optimizerArchive);
+      archive.write("optimizer" + to_string(i), optimizerArchive);
+   }
+   ostringstream archiveOut;
+   archive.save_to(archiveOut);
+   out.write(archiveOut.str());
+}
+
+void NNModel::load(CheckpointReader& in) {
+   in.read(rng_);
+
+   for (const auto& exList : allExamples_) {
+      for (auto ex : exList) {
+	 delete ex;
+      }
+   }
+   allExamples_.clear();
+   size_t numExamples;
+   in.read(numExamples);
+   for (size_t e = 0; e < numExamples; ++e) {
+      size_t trajIdx;
+      size_t t;
+      in.read(trajIdx);
+      in.read(t);
+      addExample(*in.getTrajectory(trajIdx), t);
+   }
+
+   string archiveStr;
+   in.read(archiveStr);
+   istringstream archiveIn(archiveStr);
+   torch::serialize::InputArchive archive;
+   archive.load_from(archiveIn);
+   for (size_t i = 0; i < nets_.size(); ++i) {
+      torch::serialize::InputArchive netArchive;
+      archive.read("net" + to_string(i), netArchive);
+      nets_[i]->load(netArchive);
+
+      torch::serialize::InputArchive optimizerArchive;
+      archive.read("optimizer" + to_string(i), optimizerArchive);
+      optimizers_[i]->load(optimizerArchive);
+
+      if (trainType_ == bound) {
+	 nets_[i]->updateBookkeeping();
+      }
+   }
+}
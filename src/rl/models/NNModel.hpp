@@ -3,7 +3,7 @@
 
 #include "PredictionModel.hpp"
 #include "RNG.hpp"
-#include "Params.hpp"
+#include "Config.hpp"
 #include "Example.hpp"
 
 #include <torch/torch.h>
@@ -14,7 +14,7 @@ class NNModel : public LearnedModel, public BBIPredictionModel {
   public:
    enum TrainingType {mse, bound, iqn, gaussian};
 
-   NNModel(size_t inDim, size_t targetDim, act_t numActions, const std::vector<Bound>& dimBounds, RNG& rng, TrainingType trainType, const Params& params);
+   NNModel(size_t inDim, size_t targetDim, act_t numActions, const std::vector<Bound>& dimBounds, RNG& rng, TrainingType trainType, const Config& config);
    virtual ~NNModel();
 
    virtual void addExample(const Trajectory& traj, size_t t);
@@ -50,14 +50,34 @@ class NNModel : public LearnedModel, public BBIPredictionModel {
    virtual void getRewardDistribution(const State& premise, act_t action, Normal& rewardDist) const;
    virtual void getTermDistribution(const State& premise, act_t action, Normal& termDist) const;   
 
-   virtual void getStatePredSample(const State& premise, act_t action, State& sample) const;
-   virtual rlfloat_t getRewardPredSample(const State& premise, act_t action) const;
-   virtual bool getTermPredSample(const State& premise, act_t action) const;
+   virtual void getStatePredSample(const State& premise, act_t action, State& sample, RNG& rng) const;
+   virtual rlfloat_t getRewardPredSample(const State& premise, act_t action, RNG& rng) const;
+   virtual bool getTermPredSample(const State& premise, act_t action, RNG& rng) const;
+
+   // Each network makes one pass over the whole batch
+   virtual void getStatePredictionBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<State>& predictedStates) const;
+   virtual void getRewardPredictionBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<rlfloat_t>& rewards) const;
+   virtual void getTermPredictionBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<rlfloat_t>& terms) const;
+   virtual void getStatePredSampleBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<State>& samples, const std::vector<RNG*>& rngs) const;
+   virtual void getRewardPredSampleBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<rlfloat_t>& rewards, const std::vector<RNG*>& rngs) const;
+   virtual void getTermPredSampleBatch(const std::vector<State>& premises, const std::vector<act_t>& actions, std::vector<rlfloat_t>& terms, const std::vector<RNG*>& rngs) const;
+
+   // The networks are switched between training and evaluation mode as they are used
+   virtual bool canSampleConcurrently() const {return false;}
+
+   // Includes the network weights and Adam state; examples are saved as
+   // (trajectory, time step) pairs, so the trajectories must be saved first
+   virtual void addFootprint(Footprint& footprint) const;
+
+   virtual void save(CheckpointWriter& out) const;
+   virtual void load(CheckpointReader& in);
 
   protected:
    virtual void prepareInputVector(const State& premise, act_t action, std::vector<double>& inVec) const;
    virtual torch::Tensor prepareInput(const State& premise, act_t action) const;
    virtual torch::Tensor prepareInput(const StateBound& premise, const std::vector<act_t>& action) const;
+   // One row per premise, ending in quantiles[k] for the IQN networks
+   virtual torch::Tensor prepareInput(const std::vector<State>& premises, const std::vector<act_t>& actions, const std::vector<double>& quantiles) const;
 
    virtual void prepareTargetVector(const State& result, rlfloat_t reward, rlfloat_t term, std::vector<double>& targetVec) const;
    virtual torch::Tensor prepareTarget(const State& result, rlfloat_t reward, rlfloat_t term) const;
@@ -0,0 +1,36 @@
+#ifndef ALIGNEDALLOCATOR_HPP
+#define ALIGNEDALLOCATOR_HPP
+
+#include <new>
+#include <cstddef>
+
+// Allocator for std::vector whose storage starts on an Align-byte boundary
+// (e.g. a cache line), so loops over it can use aligned vector loads
+template <class T, std::size_t Align>
+class AlignedAllocator {
+  public:
+   typedef T value_type;
+
+   template <class U>
+   struct rebind {
+      typedef AlignedAllocator<U, Align> other;
+   };
+
+   AlignedAllocator() = default;
+   template <class U>
+   AlignedAllocator(const AlignedAllocator<U, Align>&) {}
+
+   T* allocate(std::size_t n) {
+      return static_cast<T*>(::operator new(n*sizeof(T), std::align_val_t(Align)));
+   }
+   void deallocate(T* p, std::size_t) {
+      ::operator delete(p, std::align_val_t(Align));
+   }
+
+   template <class U>
+   bool operator==(const AlignedAllocator<U, Align>&) const {return true;}
+   template <class U>
+   bool operator!=(const AlignedAllocator<U, Align>&) const {return false;}
+};
+
+#endif
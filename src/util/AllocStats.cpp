@@ -0,0 +1,125 @@
+#include "AllocStats.hpp"
+
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+
+using namespace std;
+
+thread_local AllocStats::Phase AllocStats::current_ = AllocStats::other;
+thread_local size_t AllocStats::allocs_[AllocStats::numPhases] = {};
+thread_local size_t AllocStats::bytes_[AllocStats::numPhases] = {};
+
+vector<double> AllocStats::getCounts() {
+   // Copied first so that building the result is not counted in it
+   size_t allocs[numPhases];
+   size_t bytes[numPhases];
+   for (size_t p = 0; p < numPhases; ++p) {
+      allocs[p] = allocs_[p];
+      bytes[p] = bytes_[p];
+   }
+
+   vector<double> counts;
+   for (size_t p = other + 1; p < numPhases; ++p) {
+      counts.push_back(allocs[p]);
+      counts.push_back(bytes[p]);
+   }
+   return counts;
+}
+
+const vector<string>& AllocStats::getNames() {
+   static const vector<string> names({"actNew", "actBytes",
+				      "planNew", "planBytes",
+				      "learnNew", "learnBytes",
+				      "splitNew", "splitBytes",
+				      "evalNew", "evalBytes",
+				      "measNew", "measBytes"});
+   return names;
+}
+
+#ifdef ALLOC_STATS
+
+static void* countedAlloc(size_t size) {
+   AllocStats::count(size);
+   void* p = malloc(size == 0 ? 1 : size);
+   if (!p) {
+      throw bad_alloc();
+   }
+   return p;
+}
+
+static void* countedAlignedAlloc(size_t size, align_val_t align) {
+   AllocStats::count(size);
+   size_t alignment = max(size_t(align), sizeof(void*));
+   void* p = nullptr;
+   if (posix_memalign(&p, alignment, size == 0 ? 1 : size) != 0) {
+      throw bad_alloc();
+   }
+   return p;
+}
+
+void* operator new(size_t size) {
+   return countedAlloc(size);
+}
+
+void* operator new[](size_t size) {
+   return countedAlloc(size);
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept {
+   try {
+      return countedAlloc(size);
+   } catch (const bad_alloc&) {
+      return nullptr;
+   }
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+   try {
+      return countedAlloc(size);
+   } catch (const bad_alloc&) {
+      return nullptr;
+   }
+}
+
+void* operator new(size_t size, align_val_t align) {
+   return countedAlignedAlloc(size, align);
+}
+
+void* operator new[](size_t size, align_val_t align) {
+   return countedAlignedAlloc(size, align);
+}
+
+void operator delete(void* p) noexcept {
+   free(p);
+}
+
+void operator delete[](void* p) noexcept {
+   free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+   free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+   free(p);
+}
+
+void operator delete(void* p, align_val_t) noexcept {
+   free(p);
+}
+
+void operator delete[](void* p, align_val_t) noexcept {
+   free(p);
+}
+
+void operator delete(void* p, size_t, align_val_t) noexcept {
+   free(p);
+}
+
+void operator delete[](void* p, size_t, align_val_t) noexcept {
+   free(p);
+}
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef ALLOCSTATS_HPP
+#define ALLOCSTATS_HPP
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+// Counts of operator new calls and bytes requested, kept per thread and
+// charged to whichever phase of the frame loop the thread is in. In a build
+// with ALLOC_STATS defined (cmake -DALLOC_STATS=ON) the global operator new
+// and delete are replaced to keep them, and ALLOC_PHASE(phase) puts the rest
+// of the enclosing block in that phase. Otherwise ALLOC_PHASE compiles to
+// nothing and the counts stay zero.
+class AllocStats {
+  public:
+   enum Phase {other, act, plan, modelLearn, modelSplit, eval, measure, numPhases};
+
+   // Allocations, then bytes, for each phase other than other, as counted on
+   // this thread so far
+   static std::vector<double> getCounts();
+   // Column names matching getCounts()
+   static const std::vector<std::string>& getNames();
+
+   class Scope {
+     public:
+      Scope(Phase phase) : previous_(current_) {current_ = phase;}
+      ~Scope() {current_ = previous_;}
+
+      Scope(const Scope&) = delete;
+      Scope& operator=(const Scope&) = delete;
+     private:
+      Phase previous_;
+   };
+
+   static void count(std::size_t size) {
+      ++allocs_[current_];
+      bytes_[current_] += size;
+   }
+
+  private:
+   static thread_local Phase current_;
+   static thread_local std::size_t allocs_[numPhases];
+   static thread_local std::size_t bytes_[numPhases];
+};
+
+#define ALLOC_CONCAT_(a, b) a##b
+#define ALLOC_CONCAT(a, b) ALLOC_CONCAT_(a, b)
+
+#ifdef ALLOC_STATS
+#define ALLOC_PHASE(phase) AllocStats::Scope ALLOC_CONCAT(allocPhase, __LINE__)(phase)
+#else
+#define ALLOC_PHASE(phase)
+#endif
+
+#endif
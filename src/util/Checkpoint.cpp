@@ -0,0 +1,131 @@
+#include "Checkpoint.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+CheckpointWriter::CheckpointWriter(const string& filename) :
+   filename_(filename),
+   out_(ios::binary) {
+}
+
+void CheckpointWriter::write(const vector<bool>& values) {
+   write(values.size());
+   for (bool v : values) {
+      write(static_cast<unsigned char>(v));
+   }
+}
+
+void CheckpointWriter::write(const string& value) {
+   write(value.size());
+   out_.write(value.data(), value.size());
+}
+
+void CheckpointWriter::write(const RNG& rng) {
+   write(rng.getState());
+}
+
+void CheckpointWriter::addTrajectory(const Trajectory* traj) {
+   size_t index = trajIndices_.size();
+   trajIndices_[traj] = index;
+}
+
+size_t CheckpointWriter::getTrajectoryIndex(const Trajectory* traj) const {
+   auto index = trajIndices_.find(traj);
+   if (index == trajIndices_.end()) {
+      cerr << "Checkpoint refers to a trajectory that was not saved: " << filename_ << endl;
+      exit(1);
+   }
+   return index->second;
+}
+
+void CheckpointWriter::commit() {
+   string tmpFilename = filename_ + ".tmp";
+   int fd = open(tmpFilename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+   if (fd < 0) {
+      cerr << "Could not open checkpoint file for writing: " << tmpFilename << endl;
+      exit(1);
+   }
+
+   string data = out_.str();
+   size_t written = 0;
+   while (written < data.size()) {
+      ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+      if (n < 0) {
+	 cerr << "Failed writing checkpoint file: " << tmpFilename << endl;
+	 exit(1);
+      }
+      written += n;
+   }
+
+   // The data must be on disk before the rename makes it the checkpoint
+   if (fsync(fd) != 0 or close(fd) != 0) {
+      cerr << "Failed writing checkpoint file: " << tmpFilename << endl;
+      exit(1);
+   }
+   if (rename(tmpFilename.c_str(), filename_.c_str()) != 0) {
+      cerr << "Could not replace checkpoint file: " << filename_ << endl;
+      exit(1);
+   }
+}
+
+CheckpointReader::CheckpointReader(const string& filename) :
+   filename_(filename) {
+   ifstream fileIn(filename, ios::binary);
+   if (!fileIn.is_open()) {
+      cerr << "Could not open checkpoint file for reading: " << filename << endl;
+      exit(1);
+   }
+   ostringstream contents;
+   contents << fileIn.rdbuf();
+   in_.str(contents.str());
+}
+
+void CheckpointReader::read(vector<bool>& values) {
+   size_t size;
+   read(size);
+   values.resize(size);
+   for (size_t i = 0; i < size; ++i) {
+      unsigned char v;
+      read(v);
+      values[i] = v;
+   }
+}
+
+void CheckpointReader::read(string& value) {
+   size_t size;
+   read(size);
+   value.resize(size);
+   in_.read(&value[0], size);
+   check();
+}
+
+void CheckpointReader::read(RNG& rng) {
+   string state;
+   read(state);
+   rng.setState(state);
+}
+
+void CheckpointReader::addTrajectory(Trajectory* traj) {
+   trajs_.push_back(traj);
+}
+
+Trajectory* CheckpointReader::getTrajectory(size_t index) const {
+   if (index >= trajs_.size()) {
+      cerr << "Checkpoint refers to a missing trajectory: " << filename_ << endl;
+      exit(1);
+   }
+   return trajs_[index];
+}
+
+void CheckpointReader::check() {
+   if (!in_) {
+      cerr << "Truncated or corrupt checkpoint file: " << filename_ << endl;
+      exit(1);
+   }
+}
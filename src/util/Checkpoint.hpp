@@ -0,0 +1,94 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include "RNG.hpp"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <cstddef>
+#include <type_traits>
+
+class Trajectory;
+
+// Binary snapshot of a run's state. Values are stored in native byte order:
+// a checkpoint is only meant to be resumed on the machine (and build) that
+// wrote it.
+//
+// The whole checkpoint is built in memory and only written out by commit(),
+// which writes a temporary file and renames it over the old checkpoint, so a
+// crash part way through never leaves a corrupt checkpoint behind.
+class CheckpointWriter {
+  public:
+   CheckpointWriter(const std::string& filename);
+
+   template <class T>
+   void write(const T& value) {
+      static_assert(std::is_arithmetic<T>::value, "Only plain numbers can be written directly");
+      out_.write(reinterpret_cast<const char*>(&value), sizeof(T));
+   }
+
+   template <class T>
+   void write(const std::vector<T>& values) {
+      write(values.size());
+      for (const auto& v : values) {
+	 write(v);
+      }
+   }
+
+   void write(const std::vector<bool>& values);
+   void write(const std::string& value);
+   void write(const RNG& rng);
+
+   // Trajectories are written once and referred to by index afterward
+   void addTrajectory(const Trajectory* traj);
+   std::size_t getTrajectoryIndex(const Trajectory* traj) const;
+
+   // Atomically replaces the checkpoint file; exits on failure
+   void commit();
+
+  private:
+   std::string filename_;
+   std::ostringstream out_;
+   std::map<const Trajectory*, std::size_t> trajIndices_;
+};
+
+class CheckpointReader {
+  public:
+   // Exits if the file cannot be read
+   CheckpointReader(const std::string& filename);
+
+   template <class T>
+   void read(T& value) {
+      static_assert(std::is_arithmetic<T>::value, "Only plain numbers can be read directly");
+      in_.read(reinterpret_cast<char*>(&value), sizeof(T));
+      check();
+   }
+
+   template <class T>
+   void read(std::vector<T>& values) {
+      std::size_t size;
+      read(size);
+      values.resize(size);
+      for (auto& v : values) {
+	 read(v);
+      }
+   }
+
+   void read(std::vector<bool>& values);
+   void read(std::string& value);
+   void read(RNG& rng);
+
+   void addTrajectory(Trajectory* traj);
+   Trajectory* getTrajectory(std::size_t index) const;
+
+  private:
+   void check();
+
+   std::string filename_;
+   std::istringstream in_;
+   std::vector<Trajectory*> trajs_;
+};
+
+#endif
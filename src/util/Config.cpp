@@ -0,0 +1,55 @@
+#include "Config.hpp"
+#include "Hash.hpp"
+
+using namespace std;
+
+Config::Config(const Params& params) :
+   game(params.getStr("game")),
+   planner(params.getStr("planner")),
+   output(params.getStr("output")),
+   numFrames(params.getInt("num_frames")),
+   seed(params.getInt("seed")),
+   binaryOutput(params.getInt("binary_output")),
+   perfCounters(params.getInt("perf_counters")),
+   footprint(params.getInt("footprint")),
+   latencyHist(params.getInt("latency_hist")),
+   measureEvery(params.getInt("measure_every")),
+   measureFraction(params.getFloat("measure_fraction")),
+   checkpointEvery(params.getInt("checkpoint_every")),
+   resume(params.getInt("resume")),
+   heartbeat(params.getFloat("heartbeat")),
+   recordExperience(params.getStr("record_experience")),
+   replayExperience(params.getStr("replay_experience")),
+   // Checkpointing (or a heartbeat, recording, or rollout threads) changes how
+   // a run is carried out, not its results
+   runHash(params.getHash({"checkpoint_every", "resume", "heartbeat", "record_experience", "rollout_threads"}, getBuildId())),
+   gorLength(params.getInt("gor_length")),
+   gorNumInd(params.getInt("gor_num_ind")),
+   gorPrizeMult(params.getFloat("gor_prize_mult")),
+   stepSize(params.getFloat("step_size")),
+   explorationRate(params.getFloat("exploration_rate")),
+   discount(params.getFloat("discount")),
+   sparseWeights(params.getInt("sparse_weights")),
+   horizon(params.getInt("horizon")),
+   temperature(params.getFloat("temperature")),
+   decay(params.getFloat("decay")),
+   numSamples(params.getInt("num_samples")),
+   rolloutThreads(params.getInt("rollout_threads")),
+   evalEpisodes(params.getInt("eval_episodes")),
+   incRwd(params.getInt("inc_rwd")),
+   incState(params.getInt("inc_state")),
+   useVariance(params.getInt("use_variance")),
+   directionalRange(params.getInt("directional_range")),
+   rejectOverlap(params.getInt("reject_overlap")),
+   updateEvery(params.getInt("update_every")),
+   maxLeaves(params.getInt("max_leaves")),
+   predictChange(params.getInt("predict_change")),
+   splitConfidence(params.getFloat("split_confidence")),
+   tieThreshold(params.getFloat("tie_threshold")),
+   useNN(params.getInt("use_nn")),
+   hiddenSize(params.getInt("hidden_size")),
+   nnStepSize(params.getFloat("nn_step_size")),
+   batchSize(params.getInt("batch_size")),
+   useGaussian(params.getInt("use_gaussian")),
+   varianceSmoothing(params.getFloat("variance_smoothing")) {
+}
@@ -0,0 +1,77 @@
+#ifndef CONFIG_HPP
+#define CONFIG_HPP
+
+#include "Params.hpp"
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+// Typed snapshot of a fully resolved Params, read once so that nothing on the
+// per-frame path has to look settings up by name
+struct Config {
+   Config(const Params& params);
+
+   // General
+   std::string game;
+   std::string planner;
+   std::string output;
+   std::size_t numFrames;
+   std::size_t seed;
+   bool binaryOutput;
+   bool perfCounters;
+   bool footprint;
+   bool latencyHist;
+   // Which learning frames get the model and uncertainty errors measured
+   std::size_t measureEvery;
+   double measureFraction;
+   std::size_t checkpointEvery;
+   bool resume;
+   double heartbeat;
+   // Experience files written from, or played back in place of, the environment
+   std::string recordExperience;
+   std::string replayExperience;
+   // Identifies the resolved settings and the build that runs them
+   std::uint64_t runHash;
+
+   // Go Right
+   std::size_t gorLength;
+   std::size_t gorNumInd;
+   double gorPrizeMult;
+
+   // RL
+   double stepSize;
+   double explorationRate;
+   double discount;
+   bool sparseWeights;
+   std::size_t horizon;
+   double temperature;
+   double decay;
+   std::size_t numSamples;
+   std::size_t rolloutThreads;
+   std::size_t evalEpisodes;
+
+   // Set by the planner
+   bool incRwd;
+   bool incState;
+   bool useVariance;
+   bool directionalRange;
+   bool rejectOverlap;
+
+   // Decision Tree
+   std::size_t updateEvery;
+   std::size_t maxLeaves;
+   bool predictChange;
+   double splitConfidence;
+   double tieThreshold;
+
+   // Neural Network
+   bool useNN;
+   std::size_t hiddenSize;
+   double nnStepSize;
+   std::size_t batchSize;
+   bool useGaussian;
+   double varianceSmoothing;
+};
+
+#endif
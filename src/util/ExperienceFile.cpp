@@ -0,0 +1,192 @@
+#include "ExperienceFile.hpp"
+#include "Trajectory.hpp"
+
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <filesystem>
+
+using namespace std;
+
+static const char experienceMagic[8] = {'B', 'B', 'E', 'X', 'P', 'T', 'R', 'C'};
+static const uint32_t experienceVersion = 1;
+static const size_t experienceHeaderSize = sizeof(experienceMagic) + 4 + 4;
+
+ExperienceWriter::ExperienceWriter(const string& filename) :
+   filename_(filename),
+   out_(filename, ios::binary),
+   stateDim_(0) {
+   if (!out_.is_open()) {
+      cerr << "Failed to open the experience file: " << filename << endl;
+      exit(1);
+   }
+}
+
+ExperienceWriter::ExperienceWriter(const string& filename, size_t numTrajectories) :
+   filename_(filename),
+   stateDim_(0) {
+   size_t size = 0;
+   if (numTrajectories > 0) {
+      ExperienceReader reader(filename);
+      if (numTrajectories > reader.getNumTrajectories()) {
+	 cerr << "Cannot continue " << filename << " after trajectory " << numTrajectories
+	      << "; it only holds " << reader.getNumTrajectories() << endl;
+	 exit(1);
+      }
+      stateDim_ = reader.getStateDim();
+      size = reader.getSize(numTrajectories);
+   }
+
+   // With nothing to keep, the header is rewritten by the first trajectory
+   if (size == 0) {
+      out_.open(filename, ios::binary);
+   } else {
+      filesystem::resize_file(filename, size);
+      out_.open(filename, ios::binary | ios::app | ios::ate);
+   }
+   if (!out_.is_open()) {
+      cerr << "Failed to open the experience file: " << filename << endl;
+      exit(1);
+   }
+}
+
+ExperienceWriter::~ExperienceWriter() {
+   out_.close();
+}
+
+void ExperienceWriter::write(const Trajectory& traj) {
+   if (stateDim_ == 0) {
+      stateDim_ = traj.getPremiseState(0).size();
+      out_.write(experienceMagic, sizeof(experienceMagic));
+      writeLE(experienceVersion);
+      writeLE(stateDim_);
+   }
+
+   writeLE(traj.getSize());
+   writeState(traj.getPremiseState(0));
+   for (size_t t = 0; t < traj.getSize(); ++t) {
+      writeLE(traj.getAction(t));
+      writeLE(traj.getResultGameOver(t));
+      writeFloat(traj.getReward(t));
+      writeState(traj.getResultState(t));
+   }
+   out_.flush();
+}
+
+void ExperienceWriter::writeLE(uint32_t value) {
+   char bytes[4];
+   for (size_t i = 0; i < 4; ++i) {
+      bytes[i] = char((value >> (8*i)) & 0xff);
+   }
+   out_.write(bytes, 4);
+}
+
+void ExperienceWriter::writeFloat(float value) {
+   uint32_t bits;
+   memcpy(&bits, &value, sizeof(bits));
+   writeLE(bits);
+}
+
+void ExperienceWriter::writeState(const State& state) {
+   if (state.size() != stateDim_) {
+      cerr << "A state of dimension " << state.size() << " does not fit " << filename_
+	   << ", whose states have dimension " << stateDim_ << endl;
+      exit(1);
+   }
+   for (auto d : state) {
+      writeFloat(d);
+   }
+}
+
+ExperienceReader::ExperienceReader(const string& filename) :
+   filename_(filename),
+   file_(filename),
+   stateDim_(0) {
+   if (file_.size() < experienceHeaderSize or
+       memcmp(file_.data(), experienceMagic, sizeof(experienceMagic)) != 0) {
+      cerr << "Not an experience file: " << filename << endl;
+      exit(1);
+   }
+   uint32_t version = readLE(sizeof(experienceMagic));
+   if (version != experienceVersion) {
+      cerr << "Unsupported experience file version " << version << " in " << filename << endl;
+      exit(1);
+   }
+   stateDim_ = readLE(sizeof(experienceMagic) + 4);
+
+   // One pass over the step counts finds every trajectory, so any of them can
+   // be read directly afterward
+   size_t offset = experienceHeaderSize;
+   size_t startSize = 4 + 4*stateDim_;
+   size_t stepSize = 12 + 4*stateDim_;
+   while (offset + startSize <= file_.size()) {
+      size_t numSteps = readLE(offset);
+      size_t trajSize = startSize + numSteps*stepSize;
+      if (offset + trajSize > file_.size()) {
+	 break;
+      }
+      offsets_.push_back(offset);
+      offset += trajSize;
+   }
+}
+
+size_t ExperienceReader::getSize(size_t numTrajectories) const {
+   if (numTrajectories < offsets_.size()) {
+      return offsets_[numTrajectories];
+   }
+   if (offsets_.empty()) {
+      return experienceHeaderSize;
+   }
+   return getStepOffset(offsets_.size() - 1, getNumSteps(offsets_.size() - 1));
+}
+
+size_t ExperienceReader::getNumSteps(size_t traj) const {
+   return readLE(offsets_[traj]);
+}
+
+void ExperienceReader::getStartState(size_t traj, State& state) const {
+   readState(offsets_[traj] + 4, state);
+}
+
+act_t ExperienceReader::getAction(size_t traj, size_t t) const {
+   return readLE(getStepOffset(traj, t));
+}
+
+bool ExperienceReader::getTerminated(size_t traj, size_t t) const {
+   return readLE(getStepOffset(traj, t) + 4) != 0;
+}
+
+rlfloat_t ExperienceReader::getReward(size_t traj, size_t t) const {
+   return readFloat(getStepOffset(traj, t) + 8);
+}
+
+void ExperienceReader::getResultState(size_t traj, size_t t, State& state) const {
+   readState(getStepOffset(traj, t) + 12, state);
+}
+
+size_t ExperienceReader::getStepOffset(size_t traj, size_t t) const {
+   return offsets_[traj] + 4 + 4*stateDim_ + t*(12 + 4*stateDim_);
+}
+
+uint32_t ExperienceReader::readLE(size_t offset) const {
+   const unsigned char* bytes = file_.data() + offset;
+   uint32_t value = 0;
+   for (size_t i = 0; i < 4; ++i) {
+      value |= uint32_t(bytes[i]) << (8*i);
+   }
+   return value;
+}
+
+float ExperienceReader::readFloat(size_t offset) const {
+   uint32_t bits = readLE(offset);
+   float value;
+   memcpy(&value, &bits, sizeof(value));
+   return value;
+}
+
+void ExperienceReader::readState(size_t offset, State& state) const {
+   state.resize(stateDim_);
+   for (size_t i = 0; i < stateDim_; ++i) {
+      state[i] = readFloat(offset + 4*i);
+   }
+}
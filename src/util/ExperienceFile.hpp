@@ -0,0 +1,88 @@
+#ifndef EXPERIENCEFILE_HPP
+#define EXPERIENCEFILE_HPP
+
+#include "MappedFile.hpp"
+#include "RLTypes.hpp"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <cstddef>
+
+class Trajectory;
+
+// Binary record of the experience a run's learning episodes saw, one
+// trajectory per episode, so it can be played back without the environment.
+// All values are little-endian and 4 bytes wide; states and rewards are IEEE
+// floats, which hold an rlfloat_t exactly.
+//
+// Header:
+//   8 bytes   magic "BBEXPTRC"
+//   uint32    format version
+//   uint32    state dimension
+// Trajectories:
+//   uint32    number of steps
+//   float     start state (state dimension values)
+//   per step:
+//     uint32  action
+//     uint32  1 if the episode terminated on this step, else 0
+//     float   reward
+//     float   result state (state dimension values)
+//
+// A trailing partial trajectory (e.g. from a run that was killed) is ignored
+// by the reader.
+class ExperienceWriter {
+  public:
+   ExperienceWriter(const std::string& filename);
+   // Continues an existing file after its first numTrajectories trajectories,
+   // dropping any written after them
+   ExperienceWriter(const std::string& filename, std::size_t numTrajectories);
+   ~ExperienceWriter();
+
+   ExperienceWriter(const ExperienceWriter&) = delete;
+   ExperienceWriter& operator=(const ExperienceWriter&) = delete;
+
+   // The header is written with the first trajectory, which sets the state dimension
+   void write(const Trajectory& traj);
+
+  private:
+   void writeLE(std::uint32_t value);
+   void writeFloat(float value);
+   void writeState(const State& state);
+
+   std::string filename_;
+   std::ofstream out_;
+   std::size_t stateDim_;
+};
+
+class ExperienceReader {
+  public:
+   ExperienceReader(const std::string& filename);
+
+   std::size_t getStateDim() const {return stateDim_;}
+   std::size_t getNumTrajectories() const {return offsets_.size();}
+   // Bytes taken by the header and the first numTrajectories trajectories
+   std::size_t getSize(std::size_t numTrajectories) const;
+
+   std::size_t getNumSteps(std::size_t traj) const;
+   void getStartState(std::size_t traj, State& state) const;
+   act_t getAction(std::size_t traj, std::size_t t) const;
+   bool getTerminated(std::size_t traj, std::size_t t) const;
+   rlfloat_t getReward(std::size_t traj, std::size_t t) const;
+   void getResultState(std::size_t traj, std::size_t t, State& state) const;
+
+  private:
+   std::size_t getStepOffset(std::size_t traj, std::size_t t) const;
+   std::uint32_t readLE(std::size_t offset) const;
+   float readFloat(std::size_t offset) const;
+   void readState(std::size_t offset, State& state) const;
+
+   std::string filename_;
+   MappedFile file_;
+   std::size_t stateDim_;
+   // Where each whole trajectory starts
+   std::vector<std::size_t> offsets_;
+};
+
+#endif
@@ -0,0 +1,17 @@
+#include "Footprint.hpp"
+
+using namespace std;
+
+Footprint::Footprint() :
+   nodes(),
+   bytes() {
+}
+
+const vector<string>& Footprint::getNames() {
+   static const vector<string> names({"qNodes", "qBytes",
+				      "dtNodes", "dtBytes",
+				      "thrNodes", "thrBytes",
+				      "trajSteps", "trajBytes",
+				      "nnExamples", "nnExBytes"});
+   return names;
+}
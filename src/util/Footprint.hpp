@@ -0,0 +1,35 @@
+#ifndef FOOTPRINT_HPP
+#define FOOTPRINT_HPP
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+// Approximate memory held by the structures a run keeps growing, by kind.
+// Each component adds what it owns through its addFootprint() method. Bytes
+// cover the objects and the heap blocks they own (at their capacity), but not
+// allocator overhead.
+struct Footprint {
+   enum Part {qFunction, decisions, thresholds, trajectories, examples, numParts};
+
+   Footprint();
+
+   void add(Part part, std::size_t numNodes, std::size_t numBytes) {
+      nodes[part] += numNodes;
+      bytes[part] += numBytes;
+   }
+
+   // Column names: the node count, then the bytes, of each part
+   static const std::vector<std::string>& getNames();
+
+   template<typename T>
+   static std::size_t heapBytes(const std::vector<T>& v) {return v.capacity()*sizeof(T);}
+   static std::size_t heapBytes(const std::vector<bool>& v) {return v.capacity()/8;}
+   // Short strings live inside the object
+   static std::size_t heapBytes(const std::string& s) {return s.capacity() > 15 ? s.capacity() + 1 : 0;}
+
+   std::size_t nodes[numParts];
+   std::size_t bytes[numParts];
+};
+
+#endif
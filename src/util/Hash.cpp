@@ -0,0 +1,38 @@
+#include "Hash.hpp"
+
+#include <fstream>
+
+using namespace std;
+
+uint64_t fnv1a(const void* data, size_t size, uint64_t hash) {
+   const unsigned char* bytes = static_cast<const unsigned char*>(data);
+   for (size_t i = 0; i < size; ++i) {
+      hash ^= bytes[i];
+      hash *= 1099511628211ull;
+   }
+   return hash;
+}
+
+uint64_t fnv1a(const string& str, uint64_t hash) {
+   return fnv1a(str.data(), str.size(), hash);
+}
+
+static uint64_t hashExecutable() {
+   ifstream exeIn("/proc/self/exe", ios::binary);
+   if (!exeIn.is_open()) {
+      // Without /proc the best we can do is the time this file was compiled
+      return fnv1a(string(__DATE__ " " __TIME__));
+   }
+
+   uint64_t hash = fnvOffset;
+   char buffer[1 << 16];
+   while (exeIn.read(buffer, sizeof(buffer)) or exeIn.gcount() > 0) {
+      hash = fnv1a(buffer, exeIn.gcount(), hash);
+   }
+   return hash;
+}
+
+uint64_t getBuildId() {
+   static const uint64_t buildId = hashExecutable();
+   return buildId;
+}
@@ -0,0 +1,19 @@
+#ifndef HASH_HPP
+#define HASH_HPP
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// 64-bit FNV-1a. Only meant for fingerprinting settings and builds, not for
+// anything that has to resist tampering.
+const std::uint64_t fnvOffset = 14695981039346656037ull;
+
+std::uint64_t fnv1a(const void* data, std::size_t size, std::uint64_t hash = fnvOffset);
+std::uint64_t fnv1a(const std::string& str, std::uint64_t hash = fnvOffset);
+
+// Hash of the running executable's contents, computed once per process, so
+// results written by a different build never look current
+std::uint64_t getBuildId();
+
+#endif
@@ -0,0 +1,68 @@
+#include "Heartbeat.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <unistd.h>
+
+using namespace std;
+
+Heartbeat::Heartbeat(const string& filename, double interval, function<string()> getStatus) :
+   filename_(filename),
+   interval_(interval),
+   getStatus_(getStatus),
+   warned_(false),
+   stop_(false) {
+   write();
+   thread_ = thread(&Heartbeat::run, this);
+}
+
+Heartbeat::~Heartbeat() {
+   {
+      lock_guard<mutex> lock(mutex_);
+      stop_ = true;
+   }
+   wake_.notify_one();
+   thread_.join();
+   write();
+}
+
+void Heartbeat::run() {
+   unique_lock<mutex> lock(mutex_);
+   while (!wake_.wait_for(lock, chrono::duration<double>(interval_), [this] {return stop_;})) {
+      lock.unlock();
+      write();
+      lock.lock();
+   }
+}
+
+void Heartbeat::write() {
+   // A missing heartbeat should not take the run down with it
+   string tmpFilename = filename_ + ".tmp";
+   {
+      ofstream out(tmpFilename);
+      out << getStatus_();
+      if (!out) {
+	 if (!warned_) {
+	    cerr << "Could not write heartbeat file: " << tmpFilename << endl;
+	    warned_ = true;
+	 }
+	 return;
+      }
+   }
+   if (rename(tmpFilename.c_str(), filename_.c_str()) != 0 and !warned_) {
+      cerr << "Could not replace heartbeat file: " << filename_ << endl;
+      warned_ = true;
+   }
+}
+
+size_t getResidentBytes() {
+   ifstream statm("/proc/self/statm");
+   size_t totalPages = 0;
+   size_t residentPages = 0;
+   if (!(statm >> totalPages >> residentPages)) {
+      return 0;
+   }
+   return residentPages*sysconf(_SC_PAGESIZE);
+}
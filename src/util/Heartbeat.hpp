@@ -0,0 +1,41 @@
+#ifndef HEARTBEAT_HPP
+#define HEARTBEAT_HPP
+
+#include <string>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Rewrites a small status file every interval seconds from its own thread,
+// so that a scheduler or dashboard can poll how a long job is doing. Each
+// version is written to a temporary file and renamed into place, so readers
+// never see a partial one. getStatus is called on the heartbeat's thread.
+class Heartbeat {
+  public:
+   Heartbeat(const std::string& filename, double interval, std::function<std::string()> getStatus);
+   // Writes the status one last time
+   virtual ~Heartbeat();
+
+   Heartbeat(const Heartbeat&) = delete;
+   Heartbeat& operator=(const Heartbeat&) = delete;
+
+  protected:
+   virtual void run();
+   virtual void write();
+
+   std::string filename_;
+   double interval_;
+   std::function<std::string()> getStatus_;
+   bool warned_;
+
+   std::mutex mutex_;
+   std::condition_variable wake_;
+   bool stop_;
+   std::thread thread_;
+};
+
+// Resident set size of this process, in bytes (0 if unknown)
+std::size_t getResidentBytes();
+
+#endif
@@ -0,0 +1,78 @@
+#include "LatencyHistogram.hpp"
+
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+LatencyHistogram::LatencyHistogram() :
+   counts_(getBucket(numeric_limits<uint64_t>::max()) + 1, 0),
+   count_(0),
+   max_(0) {
+}
+
+void LatencyHistogram::add(const LatencyHistogram& other) {
+   for (size_t b = 0; b < counts_.size(); ++b) {
+      counts_[b] += other.counts_[b];
+   }
+   count_ += other.count_;
+   max_ = max(max_, other.max_);
+}
+
+void LatencyHistogram::clear() {
+   fill(counts_.begin(), counts_.end(), 0);
+   count_ = 0;
+   max_ = 0;
+}
+
+uint64_t LatencyHistogram::getLower(size_t bucket) {
+   if (bucket < subBuckets) {
+      return bucket;
+   }
+   unsigned shift = bucket/subBuckets - 1;
+   return (subBuckets + bucket%subBuckets) << shift;
+}
+
+uint64_t LatencyHistogram::getUpper(size_t bucket) {
+   if (bucket < subBuckets) {
+      return bucket;
+   }
+   unsigned shift = bucket/subBuckets - 1;
+   return getLower(bucket) + ((uint64_t(1) << shift) - 1);
+}
+
+uint64_t LatencyHistogram::getPercentile(double q) const {
+   if (count_ == 0) {
+      return 0;
+   }
+   // The rank of the q quantile, counting from 1
+   uint64_t rank = max(uint64_t(1), uint64_t(q*count_ + 0.5));
+   uint64_t seen = 0;
+   for (size_t b = 0; b < counts_.size(); ++b) {
+      seen += counts_[b];
+      if (seen >= rank) {
+	 return min(getUpper(b), max_);
+      }
+   }
+   return max_;
+}
+
+void LatencyHistogram::write(ostream& out) const {
+   for (size_t b = 0; b < counts_.size(); ++b) {
+      if (counts_[b] > 0) {
+	 out << getLower(b) << " " << getUpper(b) << " " << counts_[b] << "\n";
+      }
+   }
+}
+
+void LatencyHistogram::save(CheckpointWriter& out) const {
+   out.write(counts_);
+   out.write(count_);
+   out.write(max_);
+}
+
+void LatencyHistogram::load(CheckpointReader& in) {
+   in.read(counts_);
+   in.read(count_);
+   in.read(max_);
+}
@@ -0,0 +1,59 @@
+#ifndef LATENCYHISTOGRAM_HPP
+#define LATENCYHISTOGRAM_HPP
+
+#include "Checkpoint.hpp"
+
+#include <vector>
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+
+// Counts of durations in nanoseconds, bucketed in the style of HdrHistogram:
+// each power of two is split into 16 equal buckets, so every value is known
+// to within 1/16 of itself however long the tail gets.
+class LatencyHistogram {
+  public:
+   LatencyHistogram();
+
+   void record(std::uint64_t ns) {
+      ++counts_[getBucket(ns)];
+      ++count_;
+      if (ns > max_) {
+	 max_ = ns;
+      }
+   }
+   void add(const LatencyHistogram& other);
+   void clear();
+
+   std::uint64_t getCount() const {return count_;}
+   std::uint64_t getMax() const {return max_;}
+   // The upper edge of the bucket holding the q quantile (0 if empty)
+   std::uint64_t getPercentile(double q) const;
+
+   // One line per nonempty bucket: lower and upper edge (ns), then count
+   void write(std::ostream& out) const;
+
+   void save(CheckpointWriter& out) const;
+   void load(CheckpointReader& in);
+
+  private:
+   static const unsigned subBits = 4;
+   static const std::size_t subBuckets = 1 << subBits;
+
+   static std::size_t getBucket(std::uint64_t ns) {
+      if (ns < subBuckets) {
+	 return ns;
+      }
+      unsigned exponent = 63 - __builtin_clzll(ns);
+      unsigned shift = exponent - subBits;
+      return (exponent - subBits + 1)*subBuckets + ((ns >> shift) & (subBuckets - 1));
+   }
+   static std::uint64_t getLower(std::size_t bucket);
+   static std::uint64_t getUpper(std::size_t bucket);
+
+   std::vector<std::uint64_t> counts_;
+   std::uint64_t count_;
+   std::uint64_t max_;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#include "MappedFile.hpp"
+
+#include <iostream>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+MappedFile::MappedFile(const string& filename) :
+   data_(nullptr),
+   size_(0) {
+   int fd = open(filename.c_str(), O_RDONLY);
+   if (fd < 0) {
+      cerr << "Could not open file for reading: " << filename << endl;
+      exit(1);
+   }
+
+   struct stat info;
+   if (fstat(fd, &info) != 0) {
+      cerr << "Could not stat file: " << filename << endl;
+      exit(1);
+   }
+   size_ = info.st_size;
+
+   // mmap refuses empty mappings
+   if (size_ > 0) {
+      void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr == MAP_FAILED) {
+	 cerr << "Could not map file: " << filename << endl;
+	 exit(1);
+      }
+      data_ = static_cast<const unsigned char*>(addr);
+   }
+   close(fd);
+}
+
+MappedFile::~MappedFile() {
+   if (data_) {
+      munmap(const_cast<unsigned char*>(data_), size_);
+   }
+}
@@ -0,0 +1,24 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <string>
+#include <cstddef>
+
+// Read-only memory map of a whole file
+class MappedFile {
+  public:
+   MappedFile(const std::string& filename);
+   ~MappedFile();
+
+   MappedFile(const MappedFile&) = delete;
+   MappedFile& operator=(const MappedFile&) = delete;
+
+   const unsigned char* data() const {return data_;}
+   std::size_t size() const {return size_;}
+
+  private:
+   const unsigned char* data_;
+   std::size_t size_;
+};
+
+#endif
@@ -1,6 +1,9 @@
 #include "Params.hpp"
 #include "dout.hpp"
+#include "Hash.hpp"
 #include <iostream>
+#include <sstream>
+#include <algorithm>
 
 using namespace std;
 
@@ -44,3 +47,25 @@ bool Params::isSet(const string& key) const {
           floatMap.find(key) != floatMap.end() or
           intMap.find(key) != intMap.end();   
 }
+
+uint64_t Params::getHash(const vector<string>& ignore, uint64_t hash) const {
+   // Floats are written exactly, so 0.1 and 0.1000001 never collide
+   ostringstream settings;
+   settings << hexfloat;
+   for (auto& entry : strMap) {
+      if (find(ignore.begin(), ignore.end(), entry.first) == ignore.end()) {
+	 settings << entry.first << "=" << entry.second << "\n";
+      }
+   }
+   for (auto& entry : floatMap) {
+      if (find(ignore.begin(), ignore.end(), entry.first) == ignore.end()) {
+	 settings << entry.first << "=" << entry.second << "\n";
+      }
+   }
+   for (auto& entry : intMap) {
+      if (find(ignore.begin(), ignore.end(), entry.first) == ignore.end()) {
+	 settings << entry.first << "=" << entry.second << "\n";
+      }
+   }
+   return fnv1a(settings.str(), hash);
+}
@@ -3,6 +3,8 @@
 
 #include <string>
 #include <map>
+#include <vector>
+#include <cstdint>
 
 class Params
 {
@@ -19,6 +21,9 @@ class Params
    const std::string& getStr(const std::string& key) const;
 
    bool isSet(const std::string& key) const;   
+
+   // Fingerprint of every setting except those in ignore, continuing from hash
+   std::uint64_t getHash(const std::vector<std::string>& ignore, std::uint64_t hash) const;
    
   private:
    std::map<std::string, double> floatMap;
@@ -0,0 +1,93 @@
+#include "PerfCounters.hpp"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+
+using namespace std;
+
+static int openCounter(uint32_t type, uint64_t config, int groupFd) {
+   perf_event_attr attr;
+   memset(&attr, 0, sizeof(attr));
+   attr.size = sizeof(attr);
+   attr.type = type;
+   attr.config = config;
+   attr.disabled = groupFd < 0;
+   attr.exclude_kernel = 1;
+   attr.exclude_hv = 1;
+   attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+   return syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+
+PerfCounters::PerfCounters() :
+   leader_(-1),
+   fds_(numCounters, -1) {
+   vector<pair<uint32_t, uint64_t> > events({
+	 {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+	 {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+	 {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+			      (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+			      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+	 {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+	 {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}});
+
+   // The first counter that opens leads the group, so they are all scheduled
+   // together and can be switched on and off with one call
+   for (size_t c = 0; c < events.size(); ++c) {
+      fds_[c] = openCounter(events[c].first, events[c].second, leader_);
+      if (leader_ < 0) {
+	 leader_ = fds_[c];
+      }
+   }
+}
+
+PerfCounters::~PerfCounters() {
+   for (auto fd : fds_) {
+      if (fd >= 0) {
+	 close(fd);
+      }
+   }
+}
+
+void PerfCounters::start() {
+   if (leader_ >= 0) {
+      ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+   }
+}
+
+void PerfCounters::stop() {
+   if (leader_ >= 0) {
+      ioctl(leader_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+   }
+}
+
+vector<double> PerfCounters::read() const {
+   vector<double> counts(numCounters, 0);
+   if (leader_ < 0) {
+      return counts;
+   }
+
+   // nr, time enabled, time running, then one value per open counter in the
+   // order they joined the group
+   vector<uint64_t> buffer(3 + numCounters, 0);
+   if (::read(leader_, buffer.data(), buffer.size()*sizeof(uint64_t)) <= 0 or buffer[2] == 0) {
+      return counts;
+   }
+   double scale = double(buffer[1])/buffer[2];
+
+   size_t i = 0;
+   for (size_t c = 0; c < fds_.size(); ++c) {
+      if (fds_[c] >= 0 and i < buffer[0]) {
+	 counts[c] = buffer[3 + i]*scale;
+	 ++i;
+      }
+   }
+   return counts;
+}
+
+const vector<string>& PerfCounters::getNames() {
+   static const vector<string> names({"cyclesPF", "instrPF", "l1MissPF", "llcMissPF", "brMissPF"});
+   return names;
+}
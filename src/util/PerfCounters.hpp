@@ -0,0 +1,37 @@
+#ifndef PERFCOUNTERS_HPP
+#define PERFCOUNTERS_HPP
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// Hardware counters for the calling thread, read with perf_event_open. They
+// only count between start() and stop(), so they can be pointed at one phase
+// of the frame loop. Any counter the kernel or CPU does not provide (or that
+// perf_event_paranoid forbids) just reads as zero.
+class PerfCounters {
+  public:
+   enum Counter {cycles, instructions, l1dMisses, llcMisses, branchMisses, numCounters};
+
+   PerfCounters();
+   virtual ~PerfCounters();
+
+   PerfCounters(const PerfCounters&) = delete;
+   PerfCounters& operator=(const PerfCounters&) = delete;
+
+   virtual void start();
+   virtual void stop();
+
+   // Counts so far, corrected for any time the kernel multiplexed them out
+   virtual std::vector<double> read() const;
+
+   bool isAvailable() const {return leader_ >= 0;}
+
+   static const std::vector<std::string>& getNames();
+
+  private:
+   int leader_;
+   std::vector<int> fds_;
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef PHILOX_HPP
+#define PHILOX_HPP
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+// Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2,
+// 3", SC 2011) as a standard random engine. Output i is a pure function of
+// the key and i, so the whole state is the key and a position: copying it is
+// cheap, discard() is O(1), and distinct keys give independent streams.
+class Philox4x32 {
+  public:
+   typedef std::uint32_t result_type;
+
+   explicit Philox4x32(std::uint64_t key = 0) : key_(key), pos_(0), block_(~0ull), out_() {}
+
+   static constexpr result_type min() {return 0;}
+   static constexpr result_type max() {return 0xffffffffu;}
+
+   result_type operator()() {
+      std::uint64_t block = pos_ >> 2;
+      if (block != block_) {
+	 generate(block);
+      }
+      return out_[pos_++ & 3];
+   }
+
+   void discard(unsigned long long n) {pos_ += n;}
+
+   std::uint64_t getKey() const {return key_;}
+
+   friend std::ostream& operator<<(std::ostream& out, const Philox4x32& engine) {
+      return out << engine.key_ << ' ' << engine.pos_;
+   }
+   friend std::istream& operator>>(std::istream& in, Philox4x32& engine) {
+      in >> engine.key_ >> engine.pos_;
+      engine.block_ = ~0ull;
+      return in;
+   }
+
+  private:
+   void generate(std::uint64_t block) {
+      std::uint32_t c0 = std::uint32_t(block);
+      std::uint32_t c1 = std::uint32_t(block >> 32);
+      std::uint32_t c2 = 0;
+      std::uint32_t c3 = 0;
+      std::uint32_t k0 = std::uint32_t(key_);
+      std::uint32_t k1 = std::uint32_t(key_ >> 32);
+      for (unsigned r = 0; r < 10; ++r) {
+	 std::uint64_t p0 = std::uint64_t(0xD2511F53u)*c0;
+	 std::uint64_t p1 = std::uint64_t(0xCD9E8D57u)*c2;
+	 std::uint32_t hi0 = std::uint32_t(p0 >> 32);
+	 std::uint32_t hi1 = std::uint32_t(p1 >> 32);
+	 c0 = hi1 ^ c1 ^ k0;
+	 c1 = std::uint32_t(p1);
+	 c2 = hi0 ^ c3 ^ k1;
+	 c3 = std::uint32_t(p0);
+	 k0 += 0x9E3779B9u;
+	 k1 += 0xBB67AE85u;
+      }
+      out_[0] = c0;
+      out_[1] = c1;
+      out_[2] = c2;
+      out_[3] = c3;
+      block_ = block;
+   }
+
+   std::uint64_t key_;
+   std::uint64_t pos_;
+
+   // The last block computed; not part of the state
+   std::uint64_t block_;
+   std::uint32_t out_[4];
+};
+
+#endif
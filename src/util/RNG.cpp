@@ -1,7 +1,100 @@
 #include "RNG.hpp"
 #include <random>
+#include <sstream>
+#include <algorithm>
+
+using namespace std;
+
+// The splitmix64 finalizer
+static uint64_t mix(uint64_t x) {
+   x += 0x9E3779B97F4A7C15ull;
+   x = (x ^ (x >> 30))*0xBF58476D1CE4E5B9ull;
+   x = (x ^ (x >> 27))*0x94D049BB133111EBull;
+   return x ^ (x >> 31);
+}
+
+#ifdef PHILOX_RNG
+RNG::RNG(uint64_t id, bool) :
+   id_(id),
+   rng_(id) {
+}
+#else
+// Does what std::seed_seq{low, high} does, without the vector it keeps the
+// seeds in, so making a substream allocates nothing
+class PairSeedSeq {
+  public:
+   typedef uint32_t result_type;
+
+   PairSeedSeq(uint32_t low, uint32_t high) : v_{low, high} {}
+
+   template <class It>
+   void generate(It begin, It end) const {
+      size_t n = end - begin;
+      if (n == 0) {
+	 return;
+      }
+      fill(begin, end, 0x8b8b8b8bu);
+
+      const size_t s = 2;
+      size_t t = (n >= 623) ? 11 : (n >= 68) ? 7 : (n >= 39) ? 5 : (n >= 7) ? 3 : (n - 1)/2;
+      size_t p = (n - t)/2;
+      size_t q = p + t;
+      size_t m = max(s + 1, n);
+      auto scramble = [](uint32_t x) {return x ^ (x >> 27);};
+
+      for (size_t k = 0; k < m; ++k) {
+	 uint32_t r1 = 1664525u*scramble(begin[k % n] ^ begin[(k + p) % n] ^ begin[(k + n - 1) % n]);
+	 uint32_t r2 = r1;
+	 if (k == 0) {
+	    r2 += s;
+	 } else if (k <= s) {
+	    r2 += k % n + v_[k - 1];
+	 } else {
+	    r2 += k % n;
+	 }
+	 begin[(k + p) % n] += r1;
+	 begin[(k + q) % n] += r2;
+	 begin[k % n] = r2;
+      }
+      for (size_t k = m; k < m + n; ++k) {
+	 uint32_t r3 = 1566083941u*scramble(begin[k % n] + begin[(k + p) % n] + begin[(k + n - 1) % n]);
+	 uint32_t r4 = r3 - k % n;
+	 begin[(k + p) % n] ^= r3;
+	 begin[(k + q) % n] ^= r4;
+	 begin[k % n] = r4;
+      }
+   }
+
+  private:
+   uint32_t v_[2];
+};
+
+RNG::RNG(uint64_t id, bool) :
+   id_(id) {
+   PairSeedSeq seq(uint32_t(id), uint32_t(id >> 32));
+   rng_.seed(seq);
+}
+#endif
+
+RNG RNG::substream(uint64_t a, uint64_t b, uint64_t c) const {
+   uint64_t id = mix(id_ ^ mix(a));
+   id = mix(id ^ mix(b));
+   id = mix(id ^ mix(c));
+   return RNG(id, true);
+}
 
 double RNG::gaussian(double mean, double stddev) {
-   std::normal_distribution dist(mean, stddev);
+   normal_distribution dist(mean, stddev);
    return dist(rng_);
 }
+
+string RNG::getState() const {
+   ostringstream out;
+   out << id_ << ' ' << rng_ << ' ' << unitDist_;
+   return out.str();
+}
+
+void RNG::setState(const string& state) {
+   istringstream in(state);
+   in >> id_ >> rng_ >> unitDist_;
+}
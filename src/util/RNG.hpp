@@ -2,15 +2,42 @@
 #define RNG_HPP
 
 #include <random>
+#include <string>
+#include <cstdint>
+
+#ifdef PHILOX_RNG
+#include "Philox.hpp"
+#endif
 
 class RNG {
   public:
-   RNG(unsigned seed) : rng_(seed) {}
+   RNG(unsigned seed) : id_(seed), rng_(seed) {}
    double randomFloat() {return unitDist_(rng_);}
    unsigned randomInt() {return rng_();}
    double gaussian(double mean, double stddev);
+
+   // An independent generator determined only by this one's seed (or keys)
+   // and the given keys, e.g. (frame, rollout, sample), no matter how much has
+   // been drawn from this one, so work split over threads sees the same
+   // numbers however it is scheduled
+   RNG substream(std::uint64_t a, std::uint64_t b = 0, std::uint64_t c = 0) const;
+   // Skips n calls to randomInt(); constant time with the Philox engine
+   void discard(std::uint64_t n) {rng_.discard(n);}
+
+   // Text snapshot of the engine, for checkpoints
+   std::string getState() const;
+   void setState(const std::string& state);
   private:
-   std::mt19937 rng_;
+   RNG(std::uint64_t id, bool);
+
+#ifdef PHILOX_RNG
+   typedef Philox4x32 Engine;
+#else
+   typedef std::mt19937 Engine;
+#endif
+
+   std::uint64_t id_;
+   Engine rng_;
    std::uniform_real_distribution<double> unitDist_;
 };
 
@@ -0,0 +1,206 @@
+#include "ResultFile.hpp"
+
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <filesystem>
+
+using namespace std;
+
+static const char resultMagic[8] = {'B', 'B', 'R', 'E', 'S', 'U', 'L', 'T'};
+static const uint32_t resultVersion = 1;
+
+ResultWriter::ResultWriter(const string& filename) :
+   filename_(filename),
+   out_(filename, ios::binary),
+   rowCol_(0) {
+   if (!out_.is_open()) {
+      cerr << "Failed to open the output file: " << filename << endl;
+      exit(1);
+   }
+}
+
+ResultWriter::ResultWriter(const string& filename, uint64_t size) :
+   filename_(filename),
+   rowCol_(0) {
+   {
+      ResultReader reader(filename);
+      for (size_t c = 0; c < reader.getNumColumns(); ++c) {
+	 names_.push_back(reader.getColumnName(c));
+	 types_.push_back(reader.getColumnType(c));
+      }
+      size_t rowSize = 8*names_.size();
+      if (size < reader.getHeaderSize() or
+	  size > reader.getHeaderSize() + rowSize*reader.getNumRows() or
+	  (rowSize > 0 and (size - reader.getHeaderSize()) % rowSize != 0)) {
+	 cerr << "Cannot continue " << filename << " from byte " << size << endl;
+	 exit(1);
+      }
+   }
+
+   filesystem::resize_file(filename, size);
+   out_.open(filename, ios::binary | ios::app | ios::ate);
+   if (!out_.is_open()) {
+      cerr << "Failed to open the output file: " << filename << endl;
+      exit(1);
+   }
+}
+
+ResultWriter::~ResultWriter() {
+   out_.close();
+}
+
+void ResultWriter::addColumn(const string& name, ResultColumnType type) {
+   names_.push_back(name);
+   types_.push_back(type);
+}
+
+void ResultWriter::writeHeader() {
+   size_t headerSize = sizeof(resultMagic) + 4 + 4 + 8;
+   for (auto& name : names_) {
+      headerSize += 4 + 4 + name.size();
+   }
+   size_t padding = (8 - headerSize % 8) % 8;
+   headerSize += padding;
+
+   out_.write(resultMagic, sizeof(resultMagic));
+   writeLE(resultVersion, 4);
+   writeLE(names_.size(), 4);
+   writeLE(headerSize, 8);
+   for (size_t c = 0; c < names_.size(); ++c) {
+      writeLE(types_[c], 4);
+      writeLE(names_[c].size(), 4);
+      out_.write(names_[c].data(), names_[c].size());
+   }
+   for (size_t i = 0; i < padding; ++i) {
+      out_.put(0);
+   }
+   out_.flush();
+}
+
+void ResultWriter::append(uint64_t value) {
+   if (types_[rowCol_] == floatColumn) {
+      append(double(value));
+      return;
+   }
+   writeLE(value, 8);
+   ++rowCol_;
+}
+
+void ResultWriter::append(double value) {
+   if (types_[rowCol_] == intColumn) {
+      append(uint64_t(value));
+      return;
+   }
+   uint64_t bits;
+   memcpy(&bits, &value, sizeof(bits));
+   writeLE(bits, 8);
+   ++rowCol_;
+}
+
+void ResultWriter::endRow() {
+   if (rowCol_ != names_.size()) {
+      cerr << "Wrote " << rowCol_ << " of " << names_.size() << " columns in a row of " << filename_ << endl;
+      exit(1);
+   }
+   rowCol_ = 0;
+   out_.flush();
+}
+
+uint64_t ResultWriter::getSize() {
+   return out_.tellp();
+}
+
+void ResultWriter::writeLE(uint64_t value, size_t numBytes) {
+   char bytes[8];
+   for (size_t i = 0; i < numBytes; ++i) {
+      bytes[i] = char((value >> (8*i)) & 0xff);
+   }
+   out_.write(bytes, numBytes);
+}
+
+ResultReader::ResultReader(const string& filename) :
+   filename_(filename),
+   file_(filename),
+   headerSize_(0),
+   numRows_(0) {
+   size_t fixedSize = sizeof(resultMagic) + 4 + 4 + 8;
+   if (file_.size() < fixedSize or memcmp(file_.data(), resultMagic, sizeof(resultMagic)) != 0) {
+      cerr << "Not a binary result file: " << filename << endl;
+      exit(1);
+   }
+
+   size_t offset = sizeof(resultMagic);
+   uint32_t version = readLE(offset, 4);
+   offset += 4;
+   if (version != resultVersion) {
+      cerr << "Unsupported binary result version " << version << " in " << filename << endl;
+      exit(1);
+   }
+   size_t numCols = readLE(offset, 4);
+   offset += 4;
+   headerSize_ = readLE(offset, 8);
+   offset += 8;
+   if (headerSize_ > file_.size()) {
+      cerr << "Truncated header in " << filename << endl;
+      exit(1);
+   }
+
+   for (size_t c = 0; c < numCols; ++c) {
+      if (offset + 8 > headerSize_) {
+	 cerr << "Truncated header in " << filename << endl;
+	 exit(1);
+      }
+      types_.push_back(ResultColumnType(readLE(offset, 4)));
+      size_t nameLen = readLE(offset + 4, 4);
+      offset += 8;
+      if (offset + nameLen > headerSize_) {
+	 cerr << "Truncated header in " << filename << endl;
+	 exit(1);
+      }
+      names_.push_back(string(reinterpret_cast<const char*>(file_.data() + offset), nameLen));
+      offset += nameLen;
+   }
+
+   if (numCols > 0) {
+      numRows_ = (file_.size() - headerSize_)/(8*numCols);
+   }
+}
+
+size_t ResultReader::getColumnIndex(const string& name) const {
+   for (size_t c = 0; c < names_.size(); ++c) {
+      if (names_[c] == name) {
+	 return c;
+      }
+   }
+   return names_.size();
+}
+
+double ResultReader::getFloat(size_t row, size_t col) const {
+   uint64_t bits = readLE(headerSize_ + 8*(row*names_.size() + col), 8);
+   if (types_[col] == intColumn) {
+      return double(bits);
+   }
+   double value;
+   memcpy(&value, &bits, sizeof(value));
+   return value;
+}
+
+uint64_t ResultReader::getInt(size_t row, size_t col) const {
+   uint64_t bits = readLE(headerSize_ + 8*(row*names_.size() + col), 8);
+   if (types_[col] == floatColumn) {
+      double value;
+      memcpy(&value, &bits, sizeof(value));
+      return uint64_t(value);
+   }
+   return bits;
+}
+
+uint64_t ResultReader::readLE(size_t offset, size_t numBytes) const {
+   const unsigned char* bytes = file_.data() + offset;
+   uint64_t value = 0;
+   for (size_t i = 0; i < numBytes; ++i) {
+      value |= uint64_t(bytes[i]) << (8*i);
+   }
+   return value;
+}
@@ -0,0 +1,90 @@
+#ifndef RESULTFILE_HPP
+#define RESULTFILE_HPP
+
+#include "MappedFile.hpp"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <cstddef>
+
+// Binary columnar companion to the .result text table. All values are
+// little-endian.
+//
+// Header:
+//   8 bytes   magic "BBRESULT"
+//   uint32    format version
+//   uint32    number of columns
+//   uint64    header size in bytes (rows start at this offset)
+//   per column:
+//     uint32  type (ResultColumnType)
+//     uint32  name length
+//     bytes   name
+//   zero padding up to a multiple of 8 bytes
+// Rows:
+//   one 8-byte value per column (uint64 or IEEE double), appended as the run goes
+//
+// A trailing partial row (e.g. from a run that was killed) is ignored by the reader.
+enum ResultColumnType {intColumn = 0, floatColumn = 1};
+
+class ResultWriter {
+  public:
+   ResultWriter(const std::string& filename);
+   // Continues an existing file whose first size bytes (the header and some
+   // whole rows) are kept; the columns are read from its header
+   ResultWriter(const std::string& filename, std::uint64_t size);
+   ~ResultWriter();
+
+   ResultWriter(const ResultWriter&) = delete;
+   ResultWriter& operator=(const ResultWriter&) = delete;
+
+   // Columns must all be added before the header is written
+   void addColumn(const std::string& name, ResultColumnType type);
+   void writeHeader();
+
+   void append(std::uint64_t value);
+   void append(double value);
+   void endRow();
+
+   // Bytes written so far, including the header
+   std::uint64_t getSize();
+
+  private:
+   void writeLE(std::uint64_t value, std::size_t numBytes);
+
+   std::string filename_;
+   std::ofstream out_;
+   std::vector<std::string> names_;
+   std::vector<ResultColumnType> types_;
+   std::size_t rowCol_;
+};
+
+class ResultReader {
+  public:
+   ResultReader(const std::string& filename);
+
+   std::size_t getNumColumns() const {return names_.size();}
+   std::size_t getNumRows() const {return numRows_;}
+   std::size_t getHeaderSize() const {return headerSize_;}
+   const std::string& getColumnName(std::size_t col) const {return names_[col];}
+   ResultColumnType getColumnType(std::size_t col) const {return types_[col];}
+   // Returns getNumColumns() if there is no such column
+   std::size_t getColumnIndex(const std::string& name) const;
+
+   // Either accessor works for either column type
+   double getFloat(std::size_t row, std::size_t col) const;
+   std::uint64_t getInt(std::size_t row, std::size_t col) const;
+
+  private:
+   std::uint64_t readLE(std::size_t offset, std::size_t numBytes) const;
+
+   std::string filename_;
+   MappedFile file_;
+   std::vector<std::string> names_;
+   std::vector<ResultColumnType> types_;
+   std::size_t headerSize_;
+   std::size_t numRows_;
+};
+
+#endif
@@ -0,0 +1,78 @@
+#include "ThreadPool.hpp"
+
+using namespace std;
+
+ThreadPool::ThreadPool(size_t numThreads) :
+   task_(nullptr),
+   numTasks_(0),
+   nextTask_(0),
+   busyWorkers_(0),
+   loop_(0),
+   stopping_(false) {
+   for (size_t w = 1; w < numThreads; ++w) {
+      workers_.emplace_back([this] {work();});
+   }
+}
+
+ThreadPool::~ThreadPool() {
+   {
+      lock_guard<mutex> lock(mutex_);
+      stopping_ = true;
+   }
+   startLoop_.notify_all();
+   for (auto& w : workers_) {
+      w.join();
+   }
+}
+
+void ThreadPool::run(size_t numTasks, const function<void(size_t)>& task) {
+   if (workers_.empty() or numTasks <= 1) {
+      for (size_t t = 0; t < numTasks; ++t) {
+	 task(t);
+      }
+      return;
+   }
+
+   {
+      lock_guard<mutex> lock(mutex_);
+      task_ = &task;
+      numTasks_ = numTasks;
+      nextTask_ = 0;
+      busyWorkers_ = workers_.size();
+      ++loop_;
+   }
+   startLoop_.notify_all();
+
+   runTasks();
+
+   unique_lock<mutex> lock(mutex_);
+   endLoop_.wait(lock, [this] {return busyWorkers_ == 0;});
+   task_ = nullptr;
+}
+
+void ThreadPool::work() {
+   size_t lastLoop = 0;
+   unique_lock<mutex> lock(mutex_);
+   while (true) {
+      startLoop_.wait(lock, [&] {return stopping_ or loop_ != lastLoop;});
+      if (stopping_) {
+	 return;
+      }
+      lastLoop = loop_;
+
+      lock.unlock();
+      runTasks();
+      lock.lock();
+
+      if (--busyWorkers_ == 0) {
+	 endLoop_.notify_one();
+      }
+   }
+}
+
+void ThreadPool::runTasks() {
+   size_t t;
+   while ((t = nextTask_++) < numTasks_) {
+      (*task_)(t);
+   }
+}
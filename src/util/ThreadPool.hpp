@@ -0,0 +1,48 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <cstddef>
+
+// A fixed set of threads kept waiting between parallel loops, for loops too
+// short to be worth starting threads for each time. The calling thread takes
+// part in every loop, so a pool of n threads starts n - 1 of its own, and a
+// pool of one runs everything in the caller.
+class ThreadPool {
+  public:
+   ThreadPool(std::size_t numThreads);
+   virtual ~ThreadPool();
+
+   ThreadPool(const ThreadPool&) = delete;
+   ThreadPool& operator=(const ThreadPool&) = delete;
+
+   std::size_t getNumThreads() const {return workers_.size() + 1;}
+
+   // Calls task(0), ..., task(numTasks - 1) and returns once they are all
+   // done. Any thread may run any task, so they must not depend on the order.
+   virtual void run(std::size_t numTasks, const std::function<void(std::size_t)>& task);
+
+  private:
+   void work();
+   void runTasks();
+
+   std::vector<std::thread> workers_;
+   std::mutex mutex_;
+   std::condition_variable startLoop_;
+   std::condition_variable endLoop_;
+   // The current loop, and how many workers have yet to finish their part of it
+   const std::function<void(std::size_t)>* task_;
+   std::size_t numTasks_;
+   std::atomic<std::size_t> nextTask_;
+   std::size_t busyWorkers_;
+   // Counts loops, so a worker can tell a new one from the one it just did
+   std::size_t loop_;
+   bool stopping_;
+};
+
+#endif
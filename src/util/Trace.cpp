@@ -0,0 +1,117 @@
+#include "Trace.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <unistd.h>
+
+using namespace std;
+
+atomic<bool> Trace::enabled_(false);
+
+struct TraceEvent {
+   const char* name;
+   uint64_t start;
+   uint64_t end;
+};
+
+// Written only by its own thread; read by write() after the work is done
+struct TraceBuffer {
+   size_t tid;
+   vector<TraceEvent> events;
+   size_t next;
+   bool wrapped;
+};
+
+static mutex buffersMutex;
+static vector<shared_ptr<TraceBuffer> > buffers;
+static size_t bufferCapacity = 0;
+
+static TraceBuffer& getBuffer() {
+   thread_local shared_ptr<TraceBuffer> buffer;
+   if (!buffer) {
+      lock_guard<mutex> lock(buffersMutex);
+      buffer = make_shared<TraceBuffer>();
+      buffer->tid = buffers.size();
+      buffer->events.resize(bufferCapacity);
+      buffer->next = 0;
+      buffer->wrapped = false;
+      buffers.push_back(buffer);
+   }
+   return *buffer;
+}
+
+void Trace::enable(size_t capacity) {
+   {
+      lock_guard<mutex> lock(buffersMutex);
+      bufferCapacity = max(capacity, size_t(1));
+   }
+   enabled_ = true;
+}
+
+uint64_t Trace::now() {
+   return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Trace::record(const char* name, uint64_t start, uint64_t end) {
+   TraceBuffer& buffer = getBuffer();
+   buffer.events[buffer.next] = {name, start, end};
+   ++buffer.next;
+   if (buffer.next == buffer.events.size()) {
+      buffer.next = 0;
+      buffer.wrapped = true;
+   }
+}
+
+void Trace::write(const string& filename) {
+   ofstream out(filename);
+   if (!out) {
+      cerr << "Could not open trace file " << filename << endl;
+      exit(1);
+   }
+
+   lock_guard<mutex> lock(buffersMutex);
+
+   uint64_t origin = numeric_limits<uint64_t>::max();
+   for (auto& buffer : buffers) {
+      size_t first = buffer->wrapped ? buffer->next : 0;
+      if (buffer->wrapped or buffer->next > 0) {
+	 origin = min(origin, buffer->events[first].start);
+      }
+   }
+
+   // Chrome wants microseconds
+   pid_t pid = getpid();
+   out << fixed << setprecision(3);
+   out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+   bool firstEvent = true;
+   for (auto& buffer : buffers) {
+      out << (firstEvent ? "\n" : ",\n");
+      firstEvent = false;
+      out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << pid
+	  << ", \"tid\": " << buffer->tid
+	  << ", \"args\": {\"name\": \"thread " << buffer->tid << "\"}}";
+
+      size_t numEvents = buffer->wrapped ? buffer->events.size() : buffer->next;
+      size_t first = buffer->wrapped ? buffer->next : 0;
+      for (size_t i = 0; i < numEvents; ++i) {
+	 const TraceEvent& event = buffer->events[(first + i) % buffer->events.size()];
+	 out << ",\n{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": " << pid
+	     << ", \"tid\": " << buffer->tid
+	     << ", \"ts\": " << (event.start - origin)/1000.0
+	     << ", \"dur\": " << (event.end - event.start)/1000.0 << "}";
+      }
+   }
+   out << "\n]}\n";
+
+   if (!out) {
+      cerr << "Error writing trace file " << filename << endl;
+      exit(1);
+   }
+}
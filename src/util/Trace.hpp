@@ -0,0 +1,56 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <string>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Scoped timers for seeing where a frame's time goes. In a build with TRACE
+// defined (cmake -DTRACING=ON), TRACE_SCOPE("name") times the rest of the
+// enclosing block and, once tracing is enabled, records it in a per-thread
+// ring buffer. Otherwise it compiles to nothing.
+class Trace {
+  public:
+   // Starts recording; each thread keeps its most recent capacity scopes
+   static void enable(std::size_t capacity);
+   static bool isEnabled() {return enabled_.load(std::memory_order_relaxed);}
+
+   // Writes every recorded scope as Chrome trace event JSON, which
+   // chrome://tracing and Perfetto can open. Call once traced work has stopped.
+   static void write(const std::string& filename);
+
+   class Scope {
+     public:
+      Scope(const char* name) : name_(isEnabled() ? name : nullptr), start_(name_ ? now() : 0) {}
+      ~Scope() {
+	 if (name_) {
+	    record(name_, start_, now());
+	 }
+      }
+
+      Scope(const Scope&) = delete;
+      Scope& operator=(const Scope&) = delete;
+     private:
+      const char* name_;
+      std::uint64_t start_;
+   };
+
+  private:
+   // Nanoseconds on the steady clock
+   static std::uint64_t now();
+   static void record(const char* name, std::uint64_t start, std::uint64_t end);
+
+   static std::atomic<bool> enabled_;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#ifdef TRACE
+#define TRACE_SCOPE(name) Trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name)
+#endif
+
+#endif